@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+#include "esp_clk_tree.h"
+#endif
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "cj202_co2_sensor.h"
+
+#if !CONFIG_CJ202_SIMULATOR || !CONFIG_CJ202_STATS
+#error "The benchmark needs CONFIG_CJ202_SIMULATOR and CONFIG_CJ202_STATS, see sdkconfig.defaults"
+#endif
+
+static const char *TAG = "CJ202_BENCHMARK";
+
+#define BENCH_MAX_SENSORS 8
+#define BENCH_WARMUP_MS 3000        // Let the first cycles and health state settle
+#define BENCH_WINDOW_MS 20000       // Measurement window, about 20 samples per sensor
+#define BENCH_PPM_TOLERANCE 1       // Conversion rounding
+
+typedef struct {
+    cj202_handle_t handle;
+    uint32_t expected_ppm;
+    cj202_stats_t start;
+} bench_sensor_t;
+
+// Current CPU clock, or the configured default where the clock tree API is not available
+static uint32_t cpu_freq_mhz(void)
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+    uint32_t hz;
+
+    if (esp_clk_tree_src_get_freq_hz(SOC_MOD_CLK_CPU, ESP_CLK_TREE_SRC_FREQ_PRECISION_CACHED, &hz) == ESP_OK) {
+        return hz / 1000000;
+    }
+#endif
+    return CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+}
+
+static uint32_t expected_ppm(int index)
+{
+    return 400 + 350 * index;
+}
+
+// Returns the number of sensors that failed a check
+static int run(cj202_capture_mode_t mode, const char *mode_name, int count)
+{
+    bench_sensor_t sensors[BENCH_MAX_SENSORS] = {0};
+    const uint32_t cpu_mhz = cpu_freq_mhz();
+    double cpu_pct_total = 0;
+    int errors = 0, created = 0;
+
+    size_t heap_before = esp_get_free_heap_size();
+    for (int i = 0; i < count; i++) {
+        cj202_config_t config = CJ202_DEFAULT_CONFIG();
+        config.gpio_num = i;          // Only names the sensor, the simulator does not touch the pin
+        config.mode = mode;
+        config.sim.enable = true;
+        config.sim.ppm = expected_ppm(i);
+        sensors[i].expected_ppm = expected_ppm(i);
+
+        esp_err_t ret = cj202_init(&config, &sensors[i].handle);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "%s: sensor %d init failed: %s", mode_name, i, esp_err_to_name(ret));
+            errors += count - i;
+            break;
+        }
+        created++;
+    }
+    size_t heap_used = heap_before - esp_get_free_heap_size();
+
+    vTaskDelay(pdMS_TO_TICKS(BENCH_WARMUP_MS));
+
+    for (int i = 0; i < created; i++) {
+        cj202_get_stats(sensors[i].handle, &sensors[i].start);
+    }
+    int64_t start_us = esp_timer_get_time();
+
+    vTaskDelay(pdMS_TO_TICKS(BENCH_WINDOW_MS));
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    for (int i = 0; i < created; i++) {
+        const cj202_stats_t *s0 = &sensors[i].start;
+        cj202_stats_t s1;
+        cj202_sample_t sample = {0};
+
+        cj202_get_stats(sensors[i].handle, &s1);
+        esp_err_t ret = cj202_get_sample(sensors[i].handle, &sample);
+
+        uint32_t edges = s1.edges - s0->edges;
+        uint64_t isr_cycles = s1.isr_cycles - s0->isr_cycles;
+        uint32_t samples = s1.samples - s0->samples;
+        uint64_t latency_us = s1.latency_us_total - s0->latency_us_total;
+
+        // Run time counter and the esp_timer share the microsecond time base
+        double task_pct = 100.0 * (uint32_t)(s1.task_runtime - s0->task_runtime) / elapsed_us;
+        double isr_pct = 100.0 * isr_cycles / cpu_mhz / elapsed_us;
+        cpu_pct_total += task_pct + isr_pct;
+
+        int32_t ppm_error = (int32_t)sample.ppm - (int32_t)sensors[i].expected_ppm;
+        bool ok = ret == ESP_OK && sample.health == CJ202_HEALTH_OK && samples > 0 &&
+                  ppm_error >= -BENCH_PPM_TOLERANCE && ppm_error <= BENCH_PPM_TOLERANCE;
+        if (!ok) {
+            errors++;
+        }
+
+        printf("{\"mode\":\"%s\",\"sensors\":%d,\"sensor\":%d,\"cpu_pct\":%.3f,\"task_cpu_pct\":%.3f,"
+               "\"isr_cpu_pct\":%.3f,\"edges\":%" PRIu32 ",\"isr_cycles_avg\":%" PRIu32 ",\"isr_cycles_max\":%" PRIu32 ","
+               "\"samples\":%" PRIu32 ",\"latency_us_avg\":%" PRIu32 ",\"latency_us_max\":%" PRIu32 ","
+               "\"stack_free\":%" PRIu32 ",\"ppm\":%" PRIu32 ",\"expected_ppm\":%" PRIu32 ",\"health\":%d,\"ok\":%s}\n",
+               mode_name, count, i, task_pct + isr_pct, task_pct, isr_pct, edges,
+               edges ? (uint32_t)(isr_cycles / edges) : 0, s1.isr_cycles_max, samples,
+               samples ? (uint32_t)(latency_us / samples) : 0, s1.latency_us_max, s1.task_stack_free,
+               sample.ppm, sensors[i].expected_ppm, sample.health, ok ? "true" : "false");
+    }
+
+    for (int i = 0; i < created; i++) {
+        cj202_deinit(sensors[i].handle);
+    }
+    // Let the idle task reclaim the deleted capture tasks
+    vTaskDelay(pdMS_TO_TICKS(100));
+    int heap_leak = (int)(heap_before - esp_get_free_heap_size());
+    if (heap_leak != 0) {
+        ESP_LOGW(TAG, "%s: %d bytes not returned after deinit", mode_name, heap_leak);
+    }
+
+    printf("{\"mode\":\"%s\",\"sensors\":%d,\"cpu_pct_total\":%.3f,\"cpu_pct_per_sensor\":%.3f,"
+           "\"heap_per_sensor\":%u,\"heap_leak\":%d,\"errors\":%d}\n",
+           mode_name, count, cpu_pct_total, created ? cpu_pct_total / created : 0.0,
+           created ? (unsigned)(heap_used / created) : 0, heap_leak, errors);
+    return errors;
+}
+
+void app_main(void)
+{
+    int errors = 0;
+
+    ESP_LOGI(TAG, "CJ202 scaling benchmark, up to %d simulated sensors, %dms windows",
+             BENCH_MAX_SENSORS, BENCH_WINDOW_MS);
+
+    for (int count = 1; count <= BENCH_MAX_SENSORS; count *= 2) {
+        errors += run(CJ202_MODE_GPIO_INTERRUPT, "gpio", count);
+    }
+#if !defined(CONFIG_IDF_TARGET_ESP32C2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+    for (int count = 1; count <= BENCH_MAX_SENSORS; count *= 2) {
+        errors += run(CJ202_MODE_MCPWM_CAPTURE, "mcpwm", count);
+    }
+#endif
+
+    if (errors) {
+        ESP_LOGE(TAG, "Benchmark done, %d failed checks", errors);
+    } else {
+        ESP_LOGI(TAG, "Benchmark done, all checks passed");
+    }
+}
@@ -0,0 +1,22 @@
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "telemetry_bench.h"
+
+static const char *TAG = "CJ202_TELEMETRY_BENCH";
+
+static int64_t now_ns(void)
+{
+    return esp_timer_get_time() * 1000;
+}
+
+void app_main(void)
+{
+    ESP_LOGI(TAG, "CJ202 telemetry round-trip benchmark");
+
+    int mismatches = telemetry_bench_run_all(now_ns);
+    if (mismatches) {
+        ESP_LOGE(TAG, "Benchmark done, %d records did not round-trip", mismatches);
+    } else {
+        ESP_LOGI(TAG, "Benchmark done, all records round-tripped");
+    }
+}
@@ -0,0 +1,125 @@
+// Telemetry round trip shared by the ESP-IDF example and the host build in
+// host_test/, so both report the same figures for the same samples.
+// Only needs the C library and the component headers.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "cj202_co2_sensor.h"
+#include "cj202_telemetry.h"
+#include "telemetry_bench.h"
+
+#define BENCH_SAMPLES_PER_CHANNEL 300   // Five minutes at one sample per second
+#define BENCH_FRAME_SIZE 222            // LoRaWAN DR3+ maximum application payload
+#define BENCH_BASE_MS 1700000000000LL
+
+typedef struct {
+    const cj202_telemetry_record_t *expected;
+    int decoded;
+    int mismatches;
+} bench_check_t;
+
+static void check_record(const cj202_telemetry_record_t *record, void *user_ctx)
+{
+    bench_check_t *check = (bench_check_t *)user_ctx;
+    const cj202_telemetry_record_t *e = &check->expected[check->decoded++];
+
+    if (record->channel != e->channel || record->quality != e->quality ||
+        record->timestamp_ms != e->timestamp_ms || record->ppm != e->ppm) {
+        check->mismatches++;
+    }
+}
+
+// Simulated readings: slow drift with sensor noise, period jitter and the odd health flag
+static void generate(cj202_telemetry_record_t *records, int channels, int total)
+{
+    uint32_t ppm[CJ202_TELEMETRY_MAX_CHANNELS];
+    int64_t t = BENCH_BASE_MS;
+
+    for (int ch = 0; ch < channels; ch++) {
+        ppm[ch] = 420 + 150 * ch;
+    }
+
+    for (int i = 0; i < total; i++) {
+        int ch = i % channels;
+        if (ch == 0) {
+            t += 1004 + rand() % 11 - 5;
+        }
+        ppm[ch] += rand() % 9 - 4;
+        records[i] = (cj202_telemetry_record_t) {
+            .channel = ch,
+            .quality = (rand() % 200 == 0) ? CJ202_HEALTH_STALE : CJ202_HEALTH_OK,
+            .timestamp_ms = t + ch * 7,
+            .ppm = ppm[ch],
+        };
+    }
+}
+
+// Returns the number of mismatched or undecodable records
+static int run(int channels, telemetry_bench_clock_t now_ns)
+{
+    const int total = channels * BENCH_SAMPLES_PER_CHANNEL;
+    cj202_telemetry_record_t *records = calloc(total, sizeof(cj202_telemetry_record_t));
+    uint8_t frame[BENCH_FRAME_SIZE];
+    cj202_telemetry_encoder_t enc;
+    bench_check_t check = { .expected = records };
+    size_t frame_bytes = 0, json_bytes = 0;
+    int64_t encode_ns = 0, decode_ns = 0;
+    int frames = 0, next = 0, frame_first = 0;
+
+    if (records == NULL) {
+        fprintf(stderr, "Out of memory for %d records\n", total);
+        return total;
+    }
+    generate(records, channels, total);
+
+    // What the application sends today: one JSON message per sample
+    for (int i = 0; i < total; i++) {
+        char json[96];
+        json_bytes += snprintf(json, sizeof(json), "{\"ch\":%d,\"ts\":%" PRId64 ",\"ppm\":%" PRIu32 ",\"q\":%d}",
+                               records[i].channel, records[i].timestamp_ms, records[i].ppm, records[i].quality);
+    }
+
+    while (next < total) {
+        int64_t start = now_ns();
+        cj202_telemetry_encoder_init(&enc, frame, sizeof(frame), records[next].timestamp_ms);
+        frame_first = next;
+        while (next < total && cj202_telemetry_encode(&enc, &records[next]) == ESP_OK) {
+            next++;
+        }
+        encode_ns += now_ns() - start;
+
+        start = now_ns();
+        check.decoded = frame_first;
+        esp_err_t ret = cj202_telemetry_decode(frame, enc.len, check_record, &check);
+        decode_ns += now_ns() - start;
+
+        if (ret != ESP_OK || check.decoded != next) {
+            fprintf(stderr, "Frame %d failed to decode: 0x%x\n", frames, ret);
+            check.mismatches += next - frame_first;
+        }
+        frame_bytes += enc.len;
+        frames++;
+    }
+
+    printf("{\"channels\":%d,\"records\":%d,\"frames\":%d,\"frame_bytes\":%u,\"json_bytes\":%u,"
+           "\"bytes_per_record\":%.2f,\"json_bytes_per_record\":%.2f,\"messages_saved\":%d,"
+           "\"encode_ns_per_record\":%" PRId64 ",\"decode_ns_per_record\":%" PRId64 ",\"mismatches\":%d}\n",
+           channels, total, frames, (unsigned)frame_bytes, (unsigned)json_bytes,
+           (double)frame_bytes / total, (double)json_bytes / total, total - frames,
+           encode_ns / total, decode_ns / total, check.mismatches);
+
+    free(records);
+    return check.mismatches;
+}
+
+int telemetry_bench_run_all(telemetry_bench_clock_t now_ns)
+{
+    int mismatches = 0;
+
+    srand(202);
+    for (int channels = 1; channels <= CJ202_TELEMETRY_MAX_CHANNELS; channels *= 2) {
+        mismatches += run(channels, now_ns);
+    }
+    return mismatches;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Monotonic clock in nanoseconds, supplied by the platform
+ */
+typedef int64_t (*telemetry_bench_clock_t)(void);
+
+/**
+ * @brief Run the round trip for 1, 2, 4 and 8 channels
+ *
+ * Generates simulated samples, encodes them into frames, decodes and checks
+ * every record, and prints one JSON line per channel count.
+ *
+ * @param now_ns Clock used for the encode/decode timings
+ * @return Number of mismatched or undecodable records, 0 when all round trips match
+ */
+int telemetry_bench_run_all(telemetry_bench_clock_t now_ns);
+
+#ifdef __cplusplus
+}
+#endif
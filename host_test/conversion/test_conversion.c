@@ -0,0 +1,134 @@
+// cj202_conversion_init() / cj202_calculate_co2_ppm(): the fixed-point table
+// with interpolation against the reference formula
+//   Cppm = range × (TH - high_offset) / (period - period_offset)
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "cj202_internal.h"
+
+#define PERIOD_MIN_US (CJ202_PERIOD_MIN_MS * 1000)
+#define PERIOD_MAX_US (CJ202_PERIOD_MAX_MS * 1000)
+
+// cj202_common.c also holds the publish path and timer helpers, none of which run here
+int64_t esp_timer_get_time(void) { return 0; }
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) { return ESP_OK; }
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) { return ESP_OK; }
+void vTaskDelay(TickType_t ticks) {}
+void cj202_health_cycle_valid(cj202_dev_t *dev) {}
+void cj202_trend_update(cj202_dev_t *dev, uint32_t ppm, uint32_t period_us) {}
+void cj202_persist_sample(cj202_dev_t *dev, uint32_t high_us, uint32_t period_us) {}
+
+static uint32_t reference(const cj202_range_config_t *r, uint32_t high_us, uint32_t period_us)
+{
+    if (high_us <= r->high_offset_us) {
+        return 0;
+    }
+    double ppm = (double)r->range_ppm * (high_us - r->high_offset_us) / (period_us - r->period_offset_us);
+    return ppm > r->range_ppm ? r->range_ppm : (uint32_t)lround(ppm);
+}
+
+// Every period in the valid window against a spread of high times, returns the worst error
+static uint32_t sweep(const cj202_range_config_t *range)
+{
+    cj202_dev_t dev;
+    uint32_t worst = 0;
+
+    memset(&dev, 0, sizeof(dev));
+    assert(cj202_conversion_init(&dev, range) == ESP_OK);
+
+    for (uint32_t period = PERIOD_MIN_US; period <= PERIOD_MAX_US; period += 13) {
+        for (uint32_t high = 0; high <= period; high += period / 97) {
+            uint32_t got = cj202_calculate_co2_ppm(&dev, high, period);
+            uint32_t want = reference(range, high, period);
+            uint32_t err = got > want ? got - want : want - got;
+            if (err > worst) {
+                worst = err;
+            }
+        }
+        // Full scale at the top of the high range
+        assert(cj202_calculate_co2_ppm(&dev, period, period) == reference(range, period, period));
+    }
+    return worst;
+}
+
+static void test_ranges(void)
+{
+    const cj202_range_config_t ranges[] = {
+        { .range_ppm = 2000, .high_offset_us = 2000, .period_offset_us = 4000 },
+        { .range_ppm = 5000, .high_offset_us = 2000, .period_offset_us = 4000 },
+        { .range_ppm = 10000, .high_offset_us = 2000, .period_offset_us = 4000 },
+        { .range_ppm = 5000, .high_offset_us = 0, .period_offset_us = 0 },
+        { .range_ppm = 10000, .high_offset_us = 0, .period_offset_us = 0 },
+        // Largest values the 16-bit fields allow, still within the 32-bit table
+        { .range_ppm = UINT16_MAX, .high_offset_us = UINT16_MAX, .period_offset_us = UINT16_MAX },
+    };
+
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        uint32_t worst = sweep(&ranges[i]);
+        printf("range %u, offsets %u/%u: max error %u ppm\n", ranges[i].range_ppm,
+               ranges[i].high_offset_us, ranges[i].period_offset_us, worst);
+        assert(worst <= 1);
+    }
+}
+
+static void test_edges(void)
+{
+    cj202_dev_t dev;
+    const cj202_range_config_t defaults = { 0 };
+    const cj202_range_config_t cj202 = { .range_ppm = 5000, .high_offset_us = 2000, .period_offset_us = 4000 };
+
+    // range_ppm 0 selects the CJ202 defaults
+    memset(&dev, 0, sizeof(dev));
+    assert(cj202_conversion_init(&dev, &defaults) == ESP_OK);
+    assert(dev.conv.range_ppm == 5000 && dev.conv.high_offset_us == 2000 && dev.conv.period_offset_us == 4000);
+
+    // Both ends of the period window, and just outside
+    assert(cj202_calculate_co2_ppm(&dev, 100000, PERIOD_MIN_US) == reference(&cj202, 100000, PERIOD_MIN_US));
+    assert(cj202_calculate_co2_ppm(&dev, 100000, PERIOD_MAX_US) == reference(&cj202, 100000, PERIOD_MAX_US));
+    assert(cj202_calculate_co2_ppm(&dev, 100000, PERIOD_MIN_US - 1) == 0);
+    assert(cj202_calculate_co2_ppm(&dev, 100000, PERIOD_MAX_US + 1) == 0);
+
+    // High time at or below the offset reads 0
+    assert(cj202_calculate_co2_ppm(&dev, 2000, 1004000) == 0);
+    assert(cj202_calculate_co2_ppm(&dev, 1000, 1004000) == 0);
+    assert(cj202_calculate_co2_ppm(&dev, 0, 1004000) == 0);
+    assert(cj202_calculate_co2_ppm(&dev, 2001, 1004000) == 0);       // 0.005 ppm rounds down
+
+    // Clamped at full scale
+    assert(cj202_calculate_co2_ppm(&dev, 1004000, 1004000) == 5000);
+
+    // Zero offsets: a plain TH / period ratio
+    const cj202_range_config_t ratio = { .range_ppm = 10000 };
+    assert(cj202_conversion_init(&dev, &ratio) == ESP_OK);
+    assert(cj202_calculate_co2_ppm(&dev, 502000, 1004000) == 5000);
+    assert(cj202_calculate_co2_ppm(&dev, 0, 1004000) == 0);
+    assert(cj202_calculate_co2_ppm(&dev, 1, 1004000) == 0);
+}
+
+static uint32_t half(uint32_t high_us, uint32_t period_us, void *ctx)
+{
+    return high_us / 2 + *(uint32_t *)ctx;
+}
+
+static void test_transfer_fn(void)
+{
+    cj202_dev_t dev;
+    uint32_t bias = 7;
+    const cj202_range_config_t custom = { .transfer_fn = half, .transfer_ctx = &bias };
+
+    // A transfer function bypasses the table and the window checks
+    memset(&dev, 0, sizeof(dev));
+    assert(cj202_conversion_init(&dev, &custom) == ESP_OK);
+    assert(cj202_calculate_co2_ppm(&dev, 1000, 5) == 507);
+}
+
+int main(void)
+{
+    test_ranges();
+    test_edges();
+    test_transfer_fn();
+    printf("conversion: all tests passed\n");
+    return 0;
+}
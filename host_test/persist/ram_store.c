@@ -0,0 +1,75 @@
+#include <string.h>
+#include "ram_store.h"
+
+static ram_store_slot_t *find_slot(ram_store_t *store, const char *key)
+{
+    for (int i = 0; i < RAM_STORE_SLOTS; i++) {
+        if (strcmp(store->slots[i].key, key) == 0) {
+            return &store->slots[i];
+        }
+    }
+    return NULL;
+}
+
+static esp_err_t ram_load(const char *key, void *buf, size_t *len, void *ctx)
+{
+    ram_store_t *store = (ram_store_t *)ctx;
+    ram_store_slot_t *slot = find_slot(store, key);
+
+    store->loads++;
+    if (slot == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (slot->len > *len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, slot->data, slot->len);
+    *len = slot->len;
+    return ESP_OK;
+}
+
+static esp_err_t ram_store(const char *key, const void *buf, size_t len, void *ctx)
+{
+    ram_store_t *store = (ram_store_t *)ctx;
+    ram_store_slot_t *slot = find_slot(store, key);
+
+    if (store->fail_store != ESP_OK) {
+        return store->fail_store;
+    }
+    if (slot == NULL) {
+        slot = find_slot(store, "");
+    }
+    if (slot == NULL || len > RAM_STORE_BLOB_MAX || strlen(key) >= sizeof(slot->key)) {
+        return ESP_ERR_NO_MEM;
+    }
+    strcpy(slot->key, key);
+    memcpy(slot->data, buf, len);
+    slot->len = len;
+    store->stores++;
+    return ESP_OK;
+}
+
+void ram_store_init(ram_store_t *store)
+{
+    memset(store, 0, sizeof(*store));
+}
+
+cj202_persist_ops_t ram_store_ops(ram_store_t *store)
+{
+    return (cj202_persist_ops_t) {
+        .load = ram_load,
+        .store = ram_store,
+        .ctx = store,
+    };
+}
+
+uint8_t *ram_store_find(ram_store_t *store, const char *key, size_t *len)
+{
+    ram_store_slot_t *slot = find_slot(store, key);
+
+    if (slot == NULL) {
+        return NULL;
+    }
+    *len = slot->len;
+    return slot->data;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// RAM stand-in for the NVS persistence backend
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cj202_co2_sensor.h"
+
+#define RAM_STORE_SLOTS 4
+#define RAM_STORE_BLOB_MAX 512
+
+typedef struct {
+    char key[16];                      /*!< Blob key, empty for a free slot */
+    uint8_t data[RAM_STORE_BLOB_MAX];  /*!< Blob contents */
+    size_t len;                        /*!< Blob length */
+} ram_store_slot_t;
+
+typedef struct {
+    ram_store_slot_t slots[RAM_STORE_SLOTS];
+    int loads;                         /*!< load() calls */
+    int stores;                        /*!< Successful store() calls */
+    esp_err_t fail_store;              /*!< Returned by store() instead of writing, if not ESP_OK */
+} ram_store_t;
+
+/**
+ * @brief Empty the store and reset its counters
+ */
+void ram_store_init(ram_store_t *store);
+
+/**
+ * @brief Persistence ops backed by the store
+ */
+cj202_persist_ops_t ram_store_ops(ram_store_t *store);
+
+/**
+ * @brief Stored blob for a key, NULL if absent; writable to simulate corruption
+ */
+uint8_t *ram_store_find(ram_store_t *store, const char *key, size_t *len);
@@ -0,0 +1,339 @@
+// cj202_persist.c against the RAM stand-in: save, deferred save, hash skip,
+// restore, and the cases where a snapshot must be discarded
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "nvs.h"
+#include "cj202_internal.h"
+#include "ram_store.h"
+
+#define KEY "cj202_gpio4"
+#define INTERVAL CONFIG_CJ202_PERSIST_INTERVAL_SAMPLES
+
+// Fake esp_timer: timers only fire when the test says so
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    bool active;
+    uint64_t timeout_us;
+};
+
+static struct esp_timer timers[4];
+static int timers_used;
+static int64_t now_us = 1000000;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    assert(timers_used < 4);
+    timers[timers_used] = (struct esp_timer) { .callback = args->callback, .arg = args->arg };
+    *out = &timers[timers_used++];
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    if (timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = true;
+    timer->timeout_us = timeout_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    if (!timer->active) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+    return timer->active ? ESP_ERR_INVALID_STATE : ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+    return timer->active;
+}
+
+static void fire(esp_timer_handle_t timer)
+{
+    assert(timer->active);
+    timer->active = false;
+    timer->callback(timer->arg);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+}
+
+// cj202_common.c (timer teardown) is linked in, the health state is not
+void cj202_health_cycle_valid(cj202_dev_t *dev)
+{
+}
+
+// The default NVS backend is not used on the host
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+// Snapshot hash as documented on cj202_snapshot_t, to forge otherwise valid blobs
+static void rehash(cj202_snapshot_t *snap)
+{
+    const uint8_t *p = (const uint8_t *)snap;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(cj202_snapshot_t, saved_at_s); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    snap->hash = hash;
+}
+
+static ram_store_t store;
+static cj202_persist_ops_t ops;
+
+// A device as cj202_init() leaves it before persistence is set up
+static void dev_setup(cj202_dev_t *dev, uint16_t range_ppm, uint8_t window)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->gpio_num = 4;
+    dev->mode = CJ202_MODE_GPIO_INTERRUPT;
+    dev->conv.range_ppm = range_ppm;
+    dev->trend.config.window = window;
+    timers_used = 0;
+
+    const cj202_persist_config_t config = { .enable = true, .ops = &ops };
+    assert(cj202_persist_init(dev, &config) == ESP_OK);
+}
+
+// What cj202_publish_ppm() does for persistence
+static void publish(cj202_dev_t *dev, uint32_t ppm, uint32_t high_us, uint32_t period_us)
+{
+    dev->co2_ppm = ppm;
+    dev->sample_time_us = now_us;
+    dev->learned_period_us = period_us;
+    dev->trend.ring[dev->trend.count % CONFIG_CJ202_TREND_WINDOW_MAX] = (uint16_t)ppm;
+    if (dev->trend.count < dev->trend.config.window) {
+        dev->trend.count++;
+    }
+    cj202_persist_sample(dev, high_us, period_us);
+}
+
+static void test_disabled(void)
+{
+    cj202_dev_t dev;
+    const cj202_persist_config_t config = { .enable = false };
+
+    memset(&dev, 0, sizeof(dev));
+    assert(cj202_persist_init(&dev, &config) == ESP_OK);
+    assert(cj202_persist_save(&dev) == ESP_ERR_NOT_SUPPORTED);
+    cj202_persist_sample(&dev, 100000, 1004000);
+    cj202_persist_deinit(&dev);
+}
+
+static void test_bad_ops(void)
+{
+    cj202_dev_t dev;
+    const cj202_persist_ops_t half = { .load = ops.load };
+    const cj202_persist_config_t config = { .enable = true, .ops = &half };
+
+    memset(&dev, 0, sizeof(dev));
+    assert(cj202_persist_init(&dev, &config) == ESP_ERR_INVALID_ARG);
+}
+
+static void test_deferred_save(void)
+{
+    static cj202_dev_t dev;
+
+    ram_store_init(&store);
+    dev_setup(&dev, 5000, 30);
+    assert(store.loads == 1 && dev.co2_ppm == 0 && dev.sample_time_us == 0);
+
+    // Nothing is written until the interval is reached
+    for (int i = 0; i < INTERVAL - 1; i++) {
+        publish(&dev, 600, 120000, 1004000);
+    }
+    assert(!dev.persist_timer->active);
+
+    // Low level (884ms) is the longer one: write in its middle, not on the capture path
+    publish(&dev, 600, 120000, 1004000);
+    assert(dev.persist_timer->active);
+    assert(dev.persist_timer->timeout_us == (1004000 - 120000) / 2);
+    assert(store.stores == 0);
+
+    fire(dev.persist_timer);
+    assert(store.stores == 1 && dev.persist_pending == 0);
+
+    // High level (900ms) is the longer one: write in its middle, after the rising edge
+    for (int i = 0; i < INTERVAL; i++) {
+        publish(&dev, 4500, 902000, 1004000);
+    }
+    assert(dev.persist_timer->timeout_us == (1004000 - 902000) + 902000 / 2);
+    fire(dev.persist_timer);
+    assert(store.stores == 2);
+
+    // Same state again: skipped to spare the flash
+    assert(cj202_persist_save(&dev) == ESP_OK);
+    assert(store.stores == 2);
+
+    // A failed write is retried on the next save
+    dev.co2_ppm = 4400;
+    store.fail_store = ESP_FAIL;
+    assert(cj202_persist_save(&dev) == ESP_FAIL);
+    store.fail_store = ESP_OK;
+    assert(cj202_persist_save(&dev) == ESP_OK);
+    assert(store.stores == 3);
+
+    // A scheduled save is dropped on deinit, the caller saves synchronously instead
+    for (int i = 0; i < INTERVAL; i++) {
+        publish(&dev, 4300, 880000, 1004000);
+    }
+    assert(dev.persist_timer->active);
+    assert(cj202_persist_deinit(&dev) == ESP_OK);
+    assert(dev.persist_timer == NULL && !timers[0].active);
+    assert(cj202_persist_save(&dev) == ESP_OK);
+    assert(store.stores == 4);
+}
+
+static void test_restore(void)
+{
+    static cj202_dev_t dev;
+    size_t len;
+
+    // Store from test_deferred_save: 4300ppm, 1004000us, 30-sample window
+    assert(ram_store_find(&store, KEY, &len) != NULL && len == sizeof(cj202_snapshot_t));
+
+    now_us = 2000000;
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 4300);
+    assert(dev.learned_period_us == 1004000);
+    assert(dev.sample_time_us == now_us);        // get_sample() has a reading right away
+    assert(dev.trend.count == 30);
+    assert(dev.trend.config.window == 30);
+
+    // Restored state counts as written, an unchanged save is skipped
+    int stores = store.stores;
+    assert(cj202_persist_save(&dev) == ESP_OK);
+    assert(store.stores == stores);
+    cj202_persist_deinit(&dev);
+}
+
+static void test_restore_partial(void)
+{
+    static cj202_dev_t dev;
+    cj202_snapshot_t *snap;
+    size_t len;
+
+    // Different window: reading and period come back, trend history does not
+    dev_setup(&dev, 5000, 20);
+    assert(dev.co2_ppm == 4300 && dev.learned_period_us == 1004000);
+    assert(dev.trend.count == 0 && dev.trend.config.window == 20);
+    cj202_persist_deinit(&dev);
+
+    // Too old: same, saved_at_s is outside the hash
+    snap = (cj202_snapshot_t *)ram_store_find(&store, KEY, &len);
+    int64_t saved_at_s = snap->saved_at_s;
+    snap->saved_at_s -= CONFIG_CJ202_PERSIST_MAX_AGE_S + 10;
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 4300 && dev.trend.count == 0);
+    cj202_persist_deinit(&dev);
+    snap->saved_at_s = saved_at_s;
+}
+
+static void test_discard(void)
+{
+    static cj202_dev_t dev;
+    uint8_t *blob;
+    size_t len;
+
+    blob = ram_store_find(&store, KEY, &len);
+
+    // Different range: samples were converted differently
+    dev_setup(&dev, 2000, 30);
+    assert(dev.co2_ppm == 0 && dev.learned_period_us == 0 && dev.sample_time_us == 0);
+    cj202_persist_deinit(&dev);
+
+    // Different capture mode
+    memset(&dev, 0, sizeof(dev));
+    dev.gpio_num = 4;
+    dev.mode = (cj202_capture_mode_t)1;
+    dev.conv.range_ppm = 5000;
+    timers_used = 0;
+    const cj202_persist_config_t config = { .enable = true, .ops = &ops };
+    assert(cj202_persist_init(&dev, &config) == ESP_OK);
+    assert(dev.co2_ppm == 0);
+    cj202_persist_deinit(&dev);
+
+    // Unknown version, with a matching hash
+    cj202_snapshot_t *snap = (cj202_snapshot_t *)blob;
+    snap->version = CJ202_PERSIST_VERSION + 1;
+    rehash(snap);
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 0);
+    cj202_persist_deinit(&dev);
+    snap->version = CJ202_PERSIST_VERSION;
+    rehash(snap);
+
+    // Corrupted contents
+    blob[offsetof(cj202_snapshot_t, ppm)] ^= 0x01;
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 0);
+    cj202_persist_deinit(&dev);
+    blob[offsetof(cj202_snapshot_t, ppm)] ^= 0x01;
+
+    // Truncated blob
+    store.slots[0].len = len - 1;
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 0);
+    cj202_persist_deinit(&dev);
+    store.slots[0].len = len;
+
+    // Intact again
+    dev_setup(&dev, 5000, 30);
+    assert(dev.co2_ppm == 4300);
+    cj202_persist_deinit(&dev);
+}
+
+int main(void)
+{
+    ops = ram_store_ops(&store);
+
+    test_disabled();
+    test_bad_ops();
+    test_deferred_save();
+    test_restore();
+    test_restore_partial();
+    test_discard();
+    printf("persist: all tests passed\n");
+    return 0;
+}
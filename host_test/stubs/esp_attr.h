@@ -0,0 +1,6 @@
+#pragma once
+
+// Host stand-in for ESP-IDF's esp_attr.h
+
+#define IRAM_ATTR
+#define FORCE_INLINE_ATTR static inline __attribute__((always_inline))
@@ -0,0 +1,7 @@
+#pragma once
+
+// Host stand-in for FreeRTOS queue.h, declarations only
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *QueueHandle_t;
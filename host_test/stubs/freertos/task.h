@@ -0,0 +1,9 @@
+#pragma once
+
+// Host stand-in for FreeRTOS task.h, declarations only
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *TaskHandle_t;
+
+void vTaskDelay(TickType_t ticks);
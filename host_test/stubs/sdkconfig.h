@@ -0,0 +1,11 @@
+#pragma once
+
+// Host stand-in for the generated sdkconfig.h, Kconfig defaults
+
+#define CONFIG_CJ202_DEFAULT_GPIO 4
+#define CONFIG_CJ202_TREND_WINDOW_MAX 64
+#define CONFIG_CJ202_TREND_DEFAULT_WINDOW 30
+#define CONFIG_CJ202_HEALTH_DISCONNECT_MS 5000
+#define CONFIG_CJ202_HEALTH_LOG_INTERVAL_MS 10000
+#define CONFIG_CJ202_PERSIST_INTERVAL_SAMPLES 300
+#define CONFIG_CJ202_PERSIST_MAX_AGE_S 600
@@ -0,0 +1,17 @@
+// Host build of examples/cj202_telemetry_bench: the shared round trip with a
+// POSIX clock. Exits non-zero on any mismatch, so it doubles as a test.
+
+#include <time.h>
+#include "telemetry_bench.h"
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int main(void)
+{
+    return telemetry_bench_run_all(now_ns) == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+// Decoder robustness: malformed and hostile frames must be rejected, never
+// decoded into garbage or trip undefined behaviour
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cj202_telemetry.h"
+
+typedef struct {
+    int count;
+    cj202_telemetry_record_t last;
+} decode_log_t;
+
+static void log_record(const cj202_telemetry_record_t *record, void *user_ctx)
+{
+    decode_log_t *log = (decode_log_t *)user_ctx;
+
+    // Whatever a decoder hands out must be in range
+    assert(record->channel < CJ202_TELEMETRY_MAX_CHANNELS);
+    assert(record->quality < 8);
+    assert(record->timestamp_ms >= 0);
+    log->count++;
+    log->last = *record;
+}
+
+static size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+// Frame header followed by raw (tag, interval delta, ppm delta) triples
+static size_t build(uint8_t *frame, uint64_t base_ms, const int64_t (*rec)[3], int n)
+{
+    size_t len = 0;
+
+    frame[len++] = CJ202_TELEMETRY_MAGIC;
+    frame[len++] = CJ202_TELEMETRY_VERSION;
+    len += put_varint(&frame[len], base_ms);
+    for (int i = 0; i < n; i++) {
+        len += put_varint(&frame[len], (uint64_t)rec[i][0]);
+        len += put_varint(&frame[len], zigzag(rec[i][1]));
+        len += put_varint(&frame[len], zigzag(rec[i][2]));
+    }
+    return len;
+}
+
+static esp_err_t decode(const uint8_t *frame, size_t len, decode_log_t *log)
+{
+    memset(log, 0, sizeof(*log));
+    return cj202_telemetry_decode(frame, len, log_record, log);
+}
+
+static void test_valid(void)
+{
+    uint8_t frame[64];
+    decode_log_t log;
+    const int64_t rec[][3] = {
+        { 0 << 3 | 0, 1004, 420 },
+        { 0 << 3 | 1, 1, -3 },
+    };
+    size_t len = build(frame, 1000, rec, 2);
+
+    assert(decode(frame, len, &log) == ESP_OK);
+    assert(log.count == 2);
+    assert(log.last.timestamp_ms == 1000 + 1004 + 1005);
+    assert(log.last.ppm == 417 && log.last.quality == 1);
+}
+
+static void test_header(void)
+{
+    uint8_t frame[16] = { CJ202_TELEMETRY_MAGIC, CJ202_TELEMETRY_VERSION, 0x80 };
+    decode_log_t log;
+
+    assert(cj202_telemetry_decode(NULL, 3, log_record, &log) == ESP_ERR_INVALID_ARG);
+    assert(decode(frame, 2, &log) == ESP_ERR_INVALID_VERSION);
+    assert(decode(frame, 3, &log) == ESP_ERR_INVALID_SIZE);         // Truncated base
+    frame[0] = 0;
+    assert(decode(frame, 3, &log) == ESP_ERR_INVALID_VERSION);
+
+    // Base beyond INT64_MAX
+    size_t len = build(frame, UINT64_MAX, NULL, 0);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+}
+
+static void test_overflow(void)
+{
+    uint8_t frame[128];
+    decode_log_t log;
+    size_t len;
+
+    // Interval sum overflows: 2^61 then + 7 * 2^60
+    const int64_t interval[][3] = {
+        { 0, 2305843009213693952LL, 0 },
+        { 0, 8070450532247928832LL, 0 },
+    };
+    len = build(frame, 0, interval, 2);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+    assert(log.count == 1);
+
+    // Timestamp sum overflows: large base plus a large valid interval
+    const int64_t timestamp[][3] = {
+        { 0, INT64_MAX / 2 + 1, 0 },
+    };
+    len = build(frame, INT64_MAX / 2 + 1, timestamp, 1);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+    assert(log.count == 0);
+
+    // Repeated maximal intervals walk the timestamp towards INT64_MAX
+    const int64_t walk[][3] = {
+        { 0, INT64_MAX, 0 },
+        { 0, 0, 0 },
+    };
+    len = build(frame, 1, walk, 2);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+
+    // Interval going negative
+    const int64_t negative[][3] = {
+        { 0, 10, 0 },
+        { 0, -11, 0 },
+    };
+    len = build(frame, 0, negative, 2);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+
+    // ppm delta overflow and out of range
+    const int64_t ppm[][3] = {
+        { 0, 0, 4000000000LL },
+        { 0, 0, INT64_MAX },
+    };
+    len = build(frame, 0, ppm, 2);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+    assert(log.count == 1 && log.last.ppm == 4000000000u);
+    const int64_t ppm_negative[][3] = {
+        { 0, 0, -1 },
+    };
+    len = build(frame, 0, ppm_negative, 1);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+
+    // Channel out of range
+    const int64_t channel[][3] = {
+        { CJ202_TELEMETRY_MAX_CHANNELS << 3, 0, 0 },
+    };
+    len = build(frame, 0, channel, 1);
+    assert(decode(frame, len, &log) == ESP_ERR_INVALID_SIZE);
+}
+
+static void test_random(void)
+{
+    uint8_t frame[64];
+    decode_log_t log;
+
+    // Random bytes behind a valid header: any result, but no UB and sane records
+    srand(202);
+    for (int i = 0; i < 200000; i++) {
+        size_t len = 3 + rand() % (sizeof(frame) - 3);
+        frame[0] = CJ202_TELEMETRY_MAGIC;
+        frame[1] = CJ202_TELEMETRY_VERSION;
+        for (size_t j = 2; j < len; j++) {
+            frame[j] = (uint8_t)rand();
+        }
+        decode(frame, len, &log);
+    }
+}
+
+static void test_encoder_limits(void)
+{
+    uint8_t frame[16];
+    cj202_telemetry_encoder_t enc;
+    cj202_telemetry_record_t record = { .channel = 0, .timestamp_ms = 5, .ppm = 400 };
+
+    assert(cj202_telemetry_encoder_init(&enc, frame, 2, 0) == ESP_ERR_INVALID_SIZE);
+    assert(cj202_telemetry_encoder_init(&enc, frame, sizeof(frame), -1) == ESP_ERR_INVALID_ARG);
+    assert(cj202_telemetry_encoder_init(&enc, frame, sizeof(frame), 10) == ESP_OK);
+    assert(cj202_telemetry_encode(&enc, &record) == ESP_ERR_INVALID_ARG);   // Older than base
+    record.timestamp_ms = 10;
+    record.quality = 8;
+    assert(cj202_telemetry_encode(&enc, &record) == ESP_ERR_INVALID_ARG);
+    record.quality = 0;
+    record.channel = CJ202_TELEMETRY_MAX_CHANNELS;
+    assert(cj202_telemetry_encode(&enc, &record) == ESP_ERR_INVALID_ARG);
+
+    // Fill the frame; the record that does not fit leaves it unchanged
+    record.channel = 0;
+    while (cj202_telemetry_encode(&enc, &record) == ESP_OK) {
+        record.timestamp_ms += 1000;
+        record.ppm += 100;
+    }
+    size_t len = enc.len;
+    uint32_t count = enc.count;
+    assert(cj202_telemetry_encode(&enc, &record) == ESP_ERR_INVALID_SIZE);
+    assert(enc.len == len && enc.count == count);
+
+    decode_log_t log;
+    assert(decode(frame, enc.len, &log) == ESP_OK && log.count == (int)count);
+}
+
+int main(void)
+{
+    test_valid();
+    test_header();
+    test_overflow();
+    test_random();
+    test_encoder_limits();
+    printf("telemetry: all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+// cj202_trend.c: incremental least-squares slope while the window fills and
+// after it wraps, and the occupancy / ventilation detector with hysteresis
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "cj202_internal.h"
+
+#define PERIOD_US 1000000   // One sample per second, so ppm/sample × 60 = ppm/min
+
+static cj202_event_type_t events[64];
+static int event_count;
+
+// cj202_trend.c reports through cj202_emit_event(), which lives in cj202_common.c
+void cj202_emit_event(cj202_dev_t *dev, cj202_event_t *event)
+{
+    assert(event_count < 64);
+    events[event_count++] = event->type;
+}
+
+static void setup(cj202_dev_t *dev, uint8_t window, uint16_t rise, uint16_t fall, uint16_t hyst)
+{
+    cj202_trend_config_t config = {
+        .window = window,
+        .rise_ppm_per_min = rise,
+        .fall_ppm_per_min = fall,
+        .hysteresis_ppm_per_min = hyst,
+    };
+
+    memset(dev, 0, sizeof(*dev));
+    event_count = 0;
+    assert(cj202_trend_init(dev, &config) == ESP_OK);
+}
+
+// Reference slope of the last n samples, straight from the definition
+static int32_t reference_slope(const uint32_t *y, int n)
+{
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+    for (int x = 0; x < n; x++) {
+        sx += x;
+        sy += y[x];
+        sxx += (int64_t)x * x;
+        sxy += (int64_t)x * y[x];
+    }
+    return (int32_t)((n * sxy - sx * sy) * 60000000 / ((n * sxx - sx * sx) * (int64_t)PERIOD_US));
+}
+
+static void test_window_config(void)
+{
+    cj202_dev_t dev;
+    cj202_trend_config_t config = { .window = 1 };
+
+    assert(cj202_trend_init(&dev, &config) == ESP_ERR_INVALID_ARG);
+    config.window = CONFIG_CJ202_TREND_WINDOW_MAX + 1;
+    assert(cj202_trend_init(&dev, &config) == ESP_ERR_INVALID_ARG);
+    config.window = CONFIG_CJ202_TREND_WINDOW_MAX;
+    assert(cj202_trend_init(&dev, &config) == ESP_OK);
+
+    // Window 0 disables tracking entirely
+    setup(&dev, 0, 10, 10, 0);
+    for (int i = 0; i < 10; i++) {
+        cj202_trend_update(&dev, 400 + 100 * i, PERIOD_US);
+    }
+    assert(dev.trend.count == 0 && dev.trend.slope_ppm_per_min == 0 && event_count == 0);
+}
+
+static void test_linear_ramps(void)
+{
+    cj202_dev_t dev;
+    const int window = 10;
+    const int per_sample[] = { 3, 1, 0, -2, -7 };
+
+    for (size_t r = 0; r < sizeof(per_sample) / sizeof(per_sample[0]); r++) {
+        setup(&dev, window, 0, 0, 0);
+
+        // Three full wraps, slope is exact from the second sample on
+        for (int i = 0; i < 3 * window; i++) {
+            cj202_trend_update(&dev, 1000 + per_sample[r] * i, PERIOD_US);
+            if (i >= 1) {
+                assert(dev.trend.slope_ppm_per_min == per_sample[r] * 60);
+            }
+        }
+        assert(dev.trend.count == window);
+    }
+
+    // A slower period scales ppm/min down: 2 ppm per 2 s sample is 60 ppm/min
+    setup(&dev, window, 0, 0, 0);
+    for (int i = 0; i < 5; i++) {
+        cj202_trend_update(&dev, 500 + 2 * i, 2 * PERIOD_US);
+    }
+    assert(dev.trend.slope_ppm_per_min == 60);
+}
+
+static void test_incremental_matches_reference(void)
+{
+    cj202_dev_t dev;
+    const int window = 16;
+    uint32_t history[200];
+
+    setup(&dev, window, 0, 0, 0);
+    for (int i = 0; i < 200; i++) {
+        // Noisy, non-linear input exercises the sums after many wraps
+        history[i] = 600 + (uint32_t)((i * 37) % 23) * 5 + (i > 100 ? 2 * (i - 100) : 0);
+        cj202_trend_update(&dev, history[i], PERIOD_US);
+
+        int n = i + 1 < window ? i + 1 : window;
+        if (n >= 2) {
+            assert(dev.trend.slope_ppm_per_min == reference_slope(&history[i + 1 - n], n));
+        }
+    }
+}
+
+static void test_hysteresis(void)
+{
+    cj202_dev_t dev;
+    uint32_t ppm = 800;
+
+    // Rise at 60 ppm/min or more, fall at -60 or less, 20 ppm/min hysteresis
+    setup(&dev, 2, 60, 60, 20);
+
+    // Two-sample window: slope is simply the last step × 60
+    cj202_trend_update(&dev, ppm, PERIOD_US);
+    cj202_trend_update(&dev, ppm += 1, PERIOD_US);          // +60: onset
+    assert(event_count == 1 && events[0] == CJ202_EVENT_OCCUPANCY_ONSET);
+
+    cj202_trend_update(&dev, ppm += 1, PERIOD_US);          // Still rising, no repeat
+    cj202_trend_update(&dev, ppm += 0, PERIOD_US);          // 0 < 60 - 20: steady
+    assert(event_count == 2 && events[1] == CJ202_EVENT_TREND_STEADY);
+
+    cj202_trend_update(&dev, ppm -= 1, PERIOD_US);          // -60: ventilation
+    assert(event_count == 3 && events[2] == CJ202_EVENT_VENTILATION);
+
+    cj202_trend_update(&dev, ppm -= 1, PERIOD_US);          // Still falling
+    assert(event_count == 3);
+
+    // Hysteresis: leaving the state needs the slope back past the threshold by 20 ppm/min.
+    // A 1.2 s period gives -50 ppm/min, inside -60..-40, so nothing happens
+    cj202_trend_update(&dev, ppm -= 1, 1200000);
+    assert(event_count == 3 && dev.trend.slope_ppm_per_min == -50);
+    cj202_trend_update(&dev, ppm += 0, PERIOD_US);          // 0 > -60 + 20: steady
+    assert(event_count == 4 && events[3] == CJ202_EVENT_TREND_STEADY);
+
+    // Back into rising only from steady, one event per transition
+    cj202_trend_update(&dev, ppm += 2, PERIOD_US);
+    assert(event_count == 5 && events[4] == CJ202_EVENT_OCCUPANCY_ONSET);
+
+    // A slope between rise - hyst and rise keeps the rising state
+    cj202_trend_update(&dev, ppm += 1, 1200000);            // 50 ppm/min
+    assert(event_count == 5 && dev.trend.slope_ppm_per_min == 50);
+
+    // Thresholds of 0 disable that direction
+    setup(&dev, 2, 0, 60, 0);
+    cj202_trend_update(&dev, 800, PERIOD_US);
+    cj202_trend_update(&dev, 900, PERIOD_US);
+    assert(event_count == 0);
+}
+
+static void test_clamp(void)
+{
+    cj202_dev_t dev;
+
+    // Samples above the 16-bit ring range are clamped, not wrapped
+    setup(&dev, 4, 0, 0, 0);
+    cj202_trend_update(&dev, UINT16_MAX, PERIOD_US);
+    cj202_trend_update(&dev, 100000, PERIOD_US);
+    assert(dev.trend.slope_ppm_per_min == 0);
+
+    // A zero period is ignored
+    cj202_trend_update(&dev, 0, 0);
+    assert(dev.trend.count == 2);
+}
+
+int main(void)
+{
+    test_window_config();
+    test_linear_ramps();
+    test_incremental_matches_reference();
+    test_hysteresis();
+    test_clamp();
+    printf("trend: all tests passed\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+# Check that the C++ wrapper compiles down to the plain C calls.
+#
+# Usage: cmake -DASM=<wrapper_codegen.s> -P compare_codegen.cmake
+#
+# For every cpp_*/c_* pair in wrapper_codegen.cpp, the wrapper version must
+# reference the same cj202_* functions in the same order, reference no other
+# C++ symbol (no out-of-line wrapper code, allocation or exception handling),
+# and be at most CODEGEN_SLACK instructions longer. Byte-identical pairs are
+# reported as such; branch layout may legitimately differ between the two.
+
+set(PAIRS ppm sample trend health persist_flush)
+set(CODEGEN_SLACK 2)
+
+file(STRINGS "${ASM}" lines)
+
+# Sets <out>_insns (instruction lines) and <out>_syms (referenced symbols) for function <name>
+function(extract name out)
+    set(in_func FALSE)
+    set(insns "")
+    set(syms "")
+    foreach(line IN LISTS lines)
+        if(NOT in_func)
+            if(line MATCHES "^_?${name}:")
+                set(in_func TRUE)
+            endif()
+            continue()
+        endif()
+        if(line MATCHES "^[ \t]*\\.cfi_endproc")
+            break()
+        endif()
+        # Instructions are indented and are not directives
+        if(line MATCHES "^[ \t]+[^.\t ]")
+            string(STRIP "${line}" insn)
+            string(REGEX REPLACE "\\.L[A-Za-z0-9_]+" ".L" insn "${insn}")
+            list(APPEND insns "${insn}")
+            string(REGEX MATCHALL "_?(cj202_[A-Za-z0-9_]+|_Z[A-Za-z0-9_]+|__cxa_[A-Za-z0-9_]+|_Unwind_[A-Za-z0-9_]+)" found "${insn}")
+            list(APPEND syms ${found})
+        endif()
+    endforeach()
+    if(NOT in_func)
+        message(FATAL_ERROR "${name} not found in ${ASM}")
+    endif()
+    set(${out}_insns "${insns}" PARENT_SCOPE)
+    set(${out}_syms "${syms}" PARENT_SCOPE)
+endfunction()
+
+set(failed FALSE)
+foreach(pair IN LISTS PAIRS)
+    extract(cpp_${pair} cpp)
+    extract(c_${pair} c)
+    list(LENGTH cpp_insns cpp_len)
+    list(LENGTH c_insns c_len)
+    math(EXPR limit "${c_len} + ${CODEGEN_SLACK}")
+
+    if(NOT cpp_syms STREQUAL c_syms)
+        message(SEND_ERROR "${pair}: wrapper references [${cpp_syms}], C references [${c_syms}]")
+        set(failed TRUE)
+    elseif(cpp_len GREATER limit)
+        message(SEND_ERROR "${pair}: wrapper is ${cpp_len} instructions, C is ${c_len}")
+        set(failed TRUE)
+    elseif(cpp_insns STREQUAL c_insns)
+        message(STATUS "${pair}: identical (${c_len} instructions)")
+    else()
+        message(STATUS "${pair}: same calls, ${cpp_len} vs ${c_len} instructions")
+    endif()
+endforeach()
+
+if(failed)
+    message(FATAL_ERROR "C++ wrapper does not reduce to the C calls")
+endif()
@@ -0,0 +1,89 @@
+#include <limits.h>
+#include <string.h>
+#include "fake_driver.h"
+
+fake_driver_t fake_driver;
+
+// Distinct non-NULL handles, never dereferenced
+static char handles[8];
+
+void fake_driver_reset(void)
+{
+    memset(&fake_driver, 0, sizeof(fake_driver));
+    fake_driver.slope = INT32_MIN;
+}
+
+void fake_driver_emit(cj202_handle_t handle, cj202_event_type_t type)
+{
+    cj202_event_t event = {
+        .type = type,
+        .ppm = fake_driver.sample.ppm,
+        .health = fake_driver.sample.health,
+    };
+
+    if (fake_driver.cb != NULL) {
+        fake_driver.cb(handle, &event, fake_driver.cb_ctx);
+    }
+}
+
+esp_err_t cj202_init(const cj202_config_t *config, cj202_handle_t *handle)
+{
+    fake_driver.config = *config;
+    if (fake_driver.init_result != ESP_OK) {
+        return fake_driver.init_result;
+    }
+    *handle = (cj202_handle_t)&handles[fake_driver.live++ % sizeof(handles)];
+    return ESP_OK;
+}
+
+uint32_t cj202_get_ppm(cj202_handle_t handle)
+{
+    return fake_driver.sample.ppm;
+}
+
+esp_err_t cj202_get_sample(cj202_handle_t handle, cj202_sample_t *sample)
+{
+    if (!fake_driver.has_sample) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *sample = fake_driver.sample;
+    return ESP_OK;
+}
+
+cj202_health_t cj202_get_health(cj202_handle_t handle)
+{
+    return fake_driver.sample.health;
+}
+
+esp_err_t cj202_get_trend(cj202_handle_t handle, int32_t *slope_ppm_per_min)
+{
+    if (fake_driver.slope == INT32_MIN) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *slope_ppm_per_min = fake_driver.slope;
+    return ESP_OK;
+}
+
+esp_err_t cj202_register_event_callback(cj202_handle_t handle, cj202_event_cb_t cb, void *user_ctx)
+{
+    fake_driver.cb = cb;
+    fake_driver.cb_ctx = user_ctx;
+    return ESP_OK;
+}
+
+esp_err_t cj202_persist_flush(cj202_handle_t handle)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cj202_get_stats(cj202_handle_t handle, cj202_stats_t *stats)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t cj202_deinit(cj202_handle_t handle)
+{
+    fake_driver.live--;
+    fake_driver.deinit_calls++;
+    return ESP_OK;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// Host fake of the CJ202 C API, records what the C++ wrapper does with it
+
+#include "cj202_co2_sensor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    esp_err_t init_result;             /*!< Returned by the next cj202_init() */
+    cj202_config_t config;             /*!< Configuration passed to the last cj202_init() */
+    int live;                          /*!< Sensors initialized and not yet deinitialized */
+    int deinit_calls;                  /*!< cj202_deinit() calls */
+    bool has_sample;                   /*!< cj202_get_sample() succeeds */
+    cj202_sample_t sample;             /*!< Sample returned by cj202_get_sample() */
+    int32_t slope;                     /*!< Slope returned by cj202_get_trend(), INT32_MIN for none */
+    cj202_event_cb_t cb;               /*!< Registered event callback */
+    void *cb_ctx;                      /*!< Registered event callback context */
+} fake_driver_t;
+
+extern fake_driver_t fake_driver;
+
+/**
+ * @brief Reset the fake to an initialized-OK, no-sample state
+ */
+void fake_driver_reset(void);
+
+/**
+ * @brief Deliver an event through the registered callback, as the driver tasks do
+ */
+void fake_driver_emit(cj202_handle_t handle, cj202_event_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+// Behaviour of the C++ wrapper against a fake of the C API
+
+#include <cassert>
+#include <cstdio>
+#include "cj202_co2_sensor.hpp"
+#include "fake_driver.h"
+
+using Sensor = cj202::Sensor<cj202::GpioInterrupt, cj202::Range10000, cj202::Trend<10, 30, 40, 5>>;
+
+// Configuration is fixed at compile time
+static_assert(Sensor::config(5).gpio_num == 5);
+static_assert(Sensor::config(5).mode == CJ202_MODE_GPIO_INTERRUPT);
+static_assert(Sensor::config(5).range.range_ppm == 10000);
+static_assert(Sensor::config(5).range.high_offset_us == 2000);
+static_assert(Sensor::config(5).range.period_offset_us == 4000);
+static_assert(Sensor::config(5).trend.window == 10);
+static_assert(Sensor::config(5).trend.fall_ppm_per_min == 40);
+static_assert(!Sensor::config(5).sim.enable);
+static_assert(cj202::Range<2000, 0, 0>::config().high_offset_us == 0);
+
+static void test_create_failure()
+{
+    fake_driver_reset();
+    fake_driver.init_result = ESP_ERR_NO_MEM;
+
+    esp_err_t err = ESP_OK;
+    auto sensor = Sensor::create(7, &err);
+    assert(!sensor);
+    assert(err == ESP_ERR_NO_MEM);
+    assert(fake_driver.config.gpio_num == 7);
+    assert(fake_driver.deinit_calls == 0);
+}
+
+static void test_accessors()
+{
+    fake_driver_reset();
+    {
+        auto sensor = Sensor::create(5);
+        assert(sensor);
+        assert(fake_driver.config.range.range_ppm == 10000);
+
+        // Nothing published yet
+        assert(!sensor->sample());
+        assert(!sensor->ppm());
+        assert(!sensor->trend());
+
+        fake_driver.has_sample = true;
+        fake_driver.sample = cj202_sample_t{812, 1000000, CJ202_HEALTH_STALE};
+        assert(sensor->sample() && sensor->sample()->ppm == 812);
+        assert(!sensor->ppm());               // Not healthy
+        assert(sensor->health() == CJ202_HEALTH_STALE);
+
+        fake_driver.sample.health = CJ202_HEALTH_OK;
+        assert(sensor->ppm() && *sensor->ppm() == 812);
+
+        fake_driver.slope = -25;
+        assert(sensor->trend() && *sensor->trend() == -25);
+        assert(sensor->persist_flush() == ESP_ERR_NOT_SUPPORTED);
+    }
+    assert(fake_driver.deinit_calls == 1);
+    assert(fake_driver.live == 0);
+}
+
+static void test_events_and_move()
+{
+    fake_driver_reset();
+    int onsets = 0, last_ppm = 0;
+    {
+        auto created = Sensor::create(5);
+        assert(created);
+        cj202_handle_t handle = created->native_handle();
+
+        assert(created->on_event([&](const cj202_event_t &e) {
+            onsets += e.type == CJ202_EVENT_OCCUPANCY_ONSET;
+            last_ppm = e.ppm;
+        }) == ESP_OK);
+
+        // The callable lives outside the Sensor, so moving keeps the registration valid
+        Sensor sensor = std::move(*created);
+        created.reset();
+        assert(fake_driver.deinit_calls == 0);
+        assert(sensor.native_handle() == handle);
+
+        fake_driver.sample.ppm = 950;
+        fake_driver_emit(handle, CJ202_EVENT_OCCUPANCY_ONSET);
+        assert(onsets == 1 && last_ppm == 950);
+
+        // Re-registering replaces the callable
+        int steady = 0;
+        assert(sensor.on_event([&](const cj202_event_t &e) { steady += e.type == CJ202_EVENT_TREND_STEADY; }) == ESP_OK);
+        fake_driver_emit(handle, CJ202_EVENT_TREND_STEADY);
+        assert(onsets == 1 && steady == 1);
+
+        assert(sensor.clear_event_callback() == ESP_OK);
+        assert(fake_driver.cb == nullptr);
+        fake_driver_emit(handle, CJ202_EVENT_TREND_STEADY);
+        assert(steady == 1);
+
+        // Move assignment deinitializes the target's old sensor
+        auto other = Sensor::create(6);
+        assert(other && fake_driver.live == 2);
+        sensor = std::move(*other);
+        assert(fake_driver.deinit_calls == 1 && fake_driver.live == 1);
+    }
+    assert(fake_driver.deinit_calls == 2);
+    assert(fake_driver.live == 0);
+}
+
+int main()
+{
+    test_create_failure();
+    test_accessors();
+    test_events_and_move();
+    std::printf("wrapper: all tests passed\n");
+    return 0;
+}
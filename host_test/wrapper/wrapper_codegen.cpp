@@ -0,0 +1,91 @@
+// Each cpp_* function goes through the C++ wrapper, its c_* twin makes the
+// same C calls by hand on a pointer to the handle (the Sensor's first member).
+// compare_codegen.cmake checks that every pair compiles to the same code.
+
+#include "cj202_co2_sensor.hpp"
+
+using Sensor = cj202::Sensor<cj202::GpioInterrupt>;
+
+extern "C" {
+
+bool cpp_ppm(const Sensor &sensor, uint32_t *ppm)
+{
+    auto p = sensor.ppm();
+    if (!p) {
+        return false;
+    }
+    *ppm = *p;
+    return true;
+}
+
+bool c_ppm(const cj202_handle_t *handle, uint32_t *ppm)
+{
+    cj202_sample_t s;
+    if (cj202_get_sample(*handle, &s) != ESP_OK || s.health != CJ202_HEALTH_OK) {
+        return false;
+    }
+    *ppm = s.ppm;
+    return true;
+}
+
+bool cpp_sample(const Sensor &sensor, cj202_sample_t *sample)
+{
+    auto s = sensor.sample();
+    if (!s) {
+        return false;
+    }
+    *sample = *s;
+    return true;
+}
+
+bool c_sample(const cj202_handle_t *handle, cj202_sample_t *sample)
+{
+    cj202_sample_t s;
+    if (cj202_get_sample(*handle, &s) != ESP_OK) {
+        return false;
+    }
+    *sample = s;
+    return true;
+}
+
+bool cpp_trend(const Sensor &sensor, int32_t *slope)
+{
+    auto t = sensor.trend();
+    if (!t) {
+        return false;
+    }
+    *slope = *t;
+    return true;
+}
+
+bool c_trend(const cj202_handle_t *handle, int32_t *slope)
+{
+    int32_t t;
+    if (cj202_get_trend(*handle, &t) != ESP_OK) {
+        return false;
+    }
+    *slope = t;
+    return true;
+}
+
+cj202_health_t cpp_health(const Sensor &sensor)
+{
+    return sensor.health();
+}
+
+cj202_health_t c_health(const cj202_handle_t *handle)
+{
+    return cj202_get_health(*handle);
+}
+
+esp_err_t cpp_persist_flush(Sensor &sensor)
+{
+    return sensor.persist_flush();
+}
+
+esp_err_t c_persist_flush(const cj202_handle_t *handle)
+{
+    return cj202_persist_flush(*handle);
+}
+
+} // extern "C"
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -23,6 +24,81 @@ typedef enum {
  */
 typedef struct cj202_dev_t *cj202_handle_t;
 
+/**
+ * @brief Custom PWM to CO2 transfer function
+ *
+ * Called from the capture task for every valid cycle, in place of the built-in
+ * linear conversion.
+ *
+ * @param high_us High level time in microseconds
+ * @param period_us Period time in microseconds (950000-1050000)
+ * @param user_ctx User context from cj202_range_config_t
+ * @return uint32_t CO2 concentration in ppm
+ */
+typedef uint32_t (*cj202_transfer_fn_t)(uint32_t high_us, uint32_t period_us, void *user_ctx);
+
+/**
+ * @brief CO2 measuring range and PWM transfer function
+ *
+ * Built-in conversion: Cppm = range × (TH - high_offset) / (TH + TL - period_offset),
+ * clamped to 0..range. It is precomputed at init into a fixed-point table, so
+ * the per-sample path has no division or float operation.
+ * A range_ppm of 0 selects the CJ202 defaults for all three fields (5000ppm,
+ * 2ms, 4ms); otherwise the offsets are used as given, so 0 offsets give a
+ * plain TH / period ratio. The offsets are 16-bit, always well below the
+ * minimum period.
+ */
+typedef struct {
+    uint16_t range_ppm;                /*!< Full scale, e.g. 2000, 5000 or 10000 ppm, 0 for the CJ202 defaults */
+    uint16_t high_offset_us;           /*!< High level time subtracted from TH */
+    uint16_t period_offset_us;         /*!< Time subtracted from the period */
+    cj202_transfer_fn_t transfer_fn;   /*!< Optional custom conversion, overrides the linear one */
+    void *transfer_ctx;                /*!< User context passed to transfer_fn */
+} cj202_range_config_t;
+
+/**
+ * @brief CO2 trend (rate of change) configuration
+ *
+ * The slope is a least-squares fit over the last `window` samples, updated
+ * incrementally on every sample. Events fire when the slope crosses a
+ * threshold and are re-armed once it falls back by `hysteresis_ppm_per_min`.
+ */
+typedef struct {
+    uint8_t window;                    /*!< Samples in the slope window (2..CONFIG_CJ202_TREND_WINDOW_MAX), 0 disables trend tracking */
+    uint16_t rise_ppm_per_min;         /*!< Slope at or above which occupancy onset is reported */
+    uint16_t fall_ppm_per_min;         /*!< Slope at or below the negated value at which a ventilation event is reported */
+    uint16_t hysteresis_ppm_per_min;   /*!< Slope margin required to return to steady state */
+} cj202_trend_config_t;
+
+/**
+ * @brief Storage backend for persisted sensor state
+ *
+ * The built-in backend stores blobs in the "cj202" NVS namespace; supply your
+ * own to use other storage or a host-side stand-in.
+ */
+typedef struct {
+    esp_err_t (*load)(const char *key, void *buf, size_t *len, void *ctx);         /*!< Read a blob, `len` is buffer size in and blob size out. ESP_ERR_NOT_FOUND if absent */
+    esp_err_t (*store)(const char *key, const void *buf, size_t len, void *ctx);   /*!< Write and commit a blob */
+    void *ctx;                                                                    /*!< User context passed to load and store */
+} cj202_persist_ops_t;
+
+/**
+ * @brief Sensor state persistence configuration
+ */
+typedef struct {
+    bool enable;                       /*!< Restore state in cj202_init() and save it every CONFIG_CJ202_PERSIST_INTERVAL_SAMPLES samples */
+    const cj202_persist_ops_t *ops;    /*!< Storage backend, NULL for NVS (nvs_flash_init() must have been called) */
+} cj202_persist_config_t;
+
+/**
+ * @brief Simulated PWM source configuration (requires CONFIG_CJ202_SIMULATOR)
+ */
+typedef struct {
+    bool enable;                       /*!< Drive the sensor from a simulated signal instead of the GPIO */
+    uint32_t ppm;                      /*!< Simulated CO2 concentration, converted with the sensor's range */
+    uint32_t period_us;                /*!< Simulated PWM period, 0 for 1004ms */
+} cj202_sim_config_t;
+
 /**
  * @brief CJ202 CO2 sensor configuration
  */
@@ -30,6 +106,10 @@ typedef struct {
     uint8_t gpio_num;              /*!< GPIO pin number */
     cj202_capture_mode_t mode;     /*!< Capture mode */
     int intr_alloc_flags;          /*!< Interrupt allocation flags */
+    cj202_range_config_t range;    /*!< Measuring range and transfer function */
+    cj202_trend_config_t trend;    /*!< Trend and event detection */
+    cj202_persist_config_t persist; /*!< State persistence across reboots */
+    cj202_sim_config_t sim;        /*!< Simulated PWM source */
 } cj202_config_t;
 
 /**
@@ -39,8 +119,88 @@ typedef struct {
     .gpio_num = CONFIG_CJ202_DEFAULT_GPIO, \
     .mode = CJ202_MODE_GPIO_INTERRUPT, \
     .intr_alloc_flags = 0, \
+    .range = { \
+        .range_ppm = 5000, \
+        .high_offset_us = 2000, \
+        .period_offset_us = 4000, \
+    }, \
+    .trend = { \
+        .window = CONFIG_CJ202_TREND_DEFAULT_WINDOW, \
+        .rise_ppm_per_min = 20, \
+        .fall_ppm_per_min = 20, \
+        .hysteresis_ppm_per_min = 10, \
+    }, \
 }
 
+/**
+ * @brief CJ202 PWM line health
+ */
+typedef enum {
+    CJ202_HEALTH_OK,               /*!< Valid cycles arriving */
+    CJ202_HEALTH_STALE,            /*!< No valid cycle yet, or edges arriving without forming a valid cycle */
+    CJ202_HEALTH_STUCK_HIGH,       /*!< No edges within the deadline, line held high */
+    CJ202_HEALTH_STUCK_LOW,        /*!< No edges within the deadline, line held low */
+    CJ202_HEALTH_OUT_OF_SPEC,      /*!< Cycles measured with a period outside 1004ms ±5% */
+    CJ202_HEALTH_DISCONNECTED,     /*!< No edges for CONFIG_CJ202_HEALTH_DISCONNECT_MS */
+} cj202_health_t;
+
+/**
+ * @brief CJ202 CO2 sample
+ */
+typedef struct {
+    uint32_t ppm;                  /*!< Last published CO2 concentration */
+    int64_t timestamp_us;          /*!< esp_timer time at which the sample was published, or restored from persisted state */
+    cj202_health_t health;         /*!< Line health at the time of the read */
+} cj202_sample_t;
+
+/**
+ * @brief CJ202 driver statistics (requires CONFIG_CJ202_STATS)
+ *
+ * Counters are cumulative since init; take differences between two reads.
+ */
+typedef struct {
+    uint32_t edges;                    /*!< Edges handled by the capture ISR */
+    uint64_t isr_cycles;               /*!< CPU cycles spent handling them */
+    uint32_t isr_cycles_max;           /*!< Longest single edge, in CPU cycles */
+    uint32_t samples;                  /*!< Samples published */
+    uint64_t latency_us_total;         /*!< Sum over samples of end-of-pulse to publish time */
+    uint32_t latency_us_max;           /*!< Longest end-of-pulse to publish time */
+    uint32_t task_stack_free;          /*!< Capture task stack high water mark, in bytes */
+    uint32_t task_runtime;             /*!< Capture task run time counter, 0 without FreeRTOS run time stats */
+} cj202_stats_t;
+
+/**
+ * @brief CJ202 sensor event type
+ */
+typedef enum {
+    CJ202_EVENT_OCCUPANCY_ONSET,   /*!< CO2 slope rose to the rise threshold */
+    CJ202_EVENT_VENTILATION,       /*!< CO2 slope fell to the negated fall threshold */
+    CJ202_EVENT_TREND_STEADY,      /*!< CO2 slope returned inside the thresholds (minus hysteresis) */
+    CJ202_EVENT_HEALTH_CHANGED,    /*!< Line health changed, see `health` */
+} cj202_event_type_t;
+
+/**
+ * @brief CJ202 sensor event data
+ */
+typedef struct {
+    cj202_event_type_t type;       /*!< Event type */
+    uint32_t ppm;                  /*!< Last published CO2 concentration */
+    int32_t slope_ppm_per_min;     /*!< CO2 rate of change at the time of the event */
+    cj202_health_t health;         /*!< Line health at the time of the event */
+} cj202_event_t;
+
+/**
+ * @brief CJ202 sensor event callback
+ *
+ * Trend events are called from the driver's capture task, health events from
+ * the capture task or the esp_timer task. Keep it short and non-blocking.
+ *
+ * @param handle Sensor handle that raised the event
+ * @param event Event data, only valid for the duration of the call
+ * @param user_ctx User context passed to cj202_register_event_callback()
+ */
+typedef void (*cj202_event_cb_t)(cj202_handle_t handle, const cj202_event_t *event, void *user_ctx);
+
 /**
  * @brief Initialize CJ202 CO2 sensor
  * 
@@ -54,13 +214,79 @@ esp_err_t cj202_init(const cj202_config_t *config, cj202_handle_t *handle);
  * @brief Get current CO2 concentration
  * 
  * @param handle Sensor handle
- * @return uint32_t Current CO2 concentration in ppm (0-5000)
+ * @return uint32_t Current CO2 concentration in ppm (0 to the configured range)
  */
 uint32_t cj202_get_ppm(cj202_handle_t handle);
 
+/**
+ * @brief Get the last CO2 sample with its timestamp and line health
+ *
+ * A sample restored from persisted state is available right after init, with
+ * the restore time as timestamp and CJ202_HEALTH_STALE until the first new
+ * cycle is measured.
+ *
+ * @param handle Sensor handle
+ * @param sample Pointer to store the sample
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_STATE: no sample published yet, others: failed
+ */
+esp_err_t cj202_get_sample(cj202_handle_t handle, cj202_sample_t *sample);
+
+/**
+ * @brief Get PWM line health
+ *
+ * @param handle Sensor handle
+ * @return cj202_health_t Current line health (CJ202_HEALTH_DISCONNECTED for a NULL handle)
+ */
+cj202_health_t cj202_get_health(cj202_handle_t handle);
+
+/**
+ * @brief Get the CO2 rate of change
+ *
+ * @param handle Sensor handle
+ * @param slope_ppm_per_min Pointer to store the least-squares slope over the trend window
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_STATE: trend disabled or fewer than 2 samples, others: failed
+ */
+esp_err_t cj202_get_trend(cj202_handle_t handle, int32_t *slope_ppm_per_min);
+
+/**
+ * @brief Register sensor event callback
+ *
+ * Returns once no call to the previous callback is in progress, so its context
+ * can be freed right after. It must therefore not be called from the callback.
+ *
+ * @param handle Sensor handle
+ * @param cb Callback, NULL to unregister
+ * @param user_ctx User context passed to the callback
+ * @return esp_err_t ESP_OK: success, others: failed
+ */
+esp_err_t cj202_register_event_callback(cj202_handle_t handle, cj202_event_cb_t cb, void *user_ctx);
+
+/**
+ * @brief Get driver statistics
+ *
+ * @param handle Sensor handle
+ * @param stats Pointer to store the statistics
+ * @return esp_err_t ESP_OK: success, ESP_ERR_NOT_SUPPORTED: CONFIG_CJ202_STATS disabled, others: failed
+ */
+esp_err_t cj202_get_stats(cj202_handle_t handle, cj202_stats_t *stats);
+
+/**
+ * @brief Save the sensor state now
+ *
+ * Use before entering deep sleep. Skipped if nothing changed since the last save.
+ *
+ * @param handle Sensor handle
+ * @return esp_err_t ESP_OK: success, ESP_ERR_NOT_SUPPORTED: persistence not enabled, others: storage error
+ */
+esp_err_t cj202_persist_flush(cj202_handle_t handle);
+
 /**
  * @brief Deinitialize CJ202 CO2 sensor
  * 
+ * Unregisters the event callback first and waits for a call in progress to
+ * return, so it must not be called from the callback. Saves the sensor state
+ * if persistence is enabled.
+ * 
  * @param handle Sensor handle to be deinitialized
  * @return esp_err_t ESP_OK: success, others: failed
  */
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include "sdkconfig.h"
+#include "cj202_co2_sensor.h"
+
+static_assert(__cplusplus >= 201703L, "cj202_co2_sensor.hpp requires C++17");
+
+namespace cj202 {
+
+/**
+ * @brief GPIO interrupt capture backend
+ */
+struct GpioInterrupt {
+    static constexpr cj202_capture_mode_t mode = CJ202_MODE_GPIO_INTERRUPT;
+};
+
+#if !defined(CONFIG_IDF_TARGET_ESP32C2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+/**
+ * @brief MCPWM capture backend (not available on ESP32C2 and ESP32C3)
+ */
+struct McpwmCapture {
+    static constexpr cj202_capture_mode_t mode = CJ202_MODE_MCPWM_CAPTURE;
+};
+#endif
+
+/**
+ * @brief Compile-time measuring range
+ *
+ * Cppm = MaxPpm × (TH - HighOffsetUs) / (TH + TL - PeriodOffsetUs)
+ */
+template <uint16_t MaxPpm, uint16_t HighOffsetUs = 2000, uint16_t PeriodOffsetUs = 4000>
+struct Range {
+    static_assert(MaxPpm > 0, "Range must be non-zero");
+
+    static constexpr cj202_range_config_t config()
+    {
+        return cj202_range_config_t{MaxPpm, HighOffsetUs, PeriodOffsetUs, nullptr, nullptr};
+    }
+};
+
+using Range2000 = Range<2000>;
+using Range5000 = Range<5000>;
+using Range10000 = Range<10000>;
+
+/**
+ * @brief Compile-time trend window and event thresholds
+ */
+template <uint8_t Window, uint16_t RisePpmPerMin, uint16_t FallPpmPerMin, uint16_t HysteresisPpmPerMin>
+struct Trend {
+    static_assert(Window == 0 || (Window >= 2 && Window <= CONFIG_CJ202_TREND_WINDOW_MAX),
+                  "Trend window must be 0 or 2..CONFIG_CJ202_TREND_WINDOW_MAX");
+    static_assert(HysteresisPpmPerMin <= RisePpmPerMin && HysteresisPpmPerMin <= FallPpmPerMin,
+                  "Hysteresis must not exceed the thresholds");
+
+    static constexpr cj202_trend_config_t config()
+    {
+        return cj202_trend_config_t{Window, RisePpmPerMin, FallPpmPerMin, HysteresisPpmPerMin};
+    }
+};
+
+using DefaultTrend = Trend<CONFIG_CJ202_TREND_DEFAULT_WINDOW, 20, 20, 10>;
+using NoTrend = Trend<0, 0, 0, 0>;
+
+/**
+ * @brief RAII CJ202 sensor
+ *
+ * Backend, range and trend are template parameters, so the capture mode and
+ * all configuration checks are fixed at compile time. Every accessor is an
+ * inline forward to the mode-independent C API.
+ *
+ * Move-only; the sensor is deinitialized when the owning object is destroyed.
+ */
+template <typename Backend, typename RangeT = Range5000, typename TrendT = DefaultTrend>
+class Sensor {
+public:
+    using EventCallback = std::function<void(const cj202_event_t &)>;
+
+    /**
+     * @brief Driver configuration for this sensor type
+     */
+    static constexpr cj202_config_t config(uint8_t gpio_num, int intr_alloc_flags = 0,
+                                           cj202_persist_config_t persist = {})
+    {
+        return cj202_config_t{gpio_num, Backend::mode, intr_alloc_flags, RangeT::config(), TrendT::config(), persist, {}};
+    }
+
+    /**
+     * @brief Initialize a sensor
+     *
+     * @param gpio_num GPIO pin connected to the sensor's PWM output
+     * @param err Optional pointer to store the cj202_init() result
+     * @param intr_alloc_flags Interrupt allocation flags
+     * @param persist State persistence, disabled by default
+     * @return std::optional<Sensor> The sensor, or std::nullopt if initialization failed
+     */
+    static std::optional<Sensor> create(uint8_t gpio_num, esp_err_t *err = nullptr, int intr_alloc_flags = 0,
+                                        cj202_persist_config_t persist = {})
+    {
+        const cj202_config_t cfg = config(gpio_num, intr_alloc_flags, persist);
+        cj202_handle_t handle = nullptr;
+        esp_err_t ret = cj202_init(&cfg, &handle);
+        if (err != nullptr) {
+            *err = ret;
+        }
+        if (ret != ESP_OK) {
+            return std::nullopt;
+        }
+        return Sensor(handle);
+    }
+
+    Sensor(const Sensor &) = delete;
+    Sensor &operator=(const Sensor &) = delete;
+
+    Sensor(Sensor &&other) noexcept
+        : handle_(std::exchange(other.handle_, nullptr)), callback_(std::move(other.callback_)) {}
+
+    Sensor &operator=(Sensor &&other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            handle_ = std::exchange(other.handle_, nullptr);
+            callback_ = std::move(other.callback_);
+        }
+        return *this;
+    }
+
+    ~Sensor()
+    {
+        reset();
+    }
+
+    /**
+     * @brief Last sample, or std::nullopt if none has been published yet
+     */
+    std::optional<cj202_sample_t> sample() const
+    {
+        cj202_sample_t s;
+        if (cj202_get_sample(handle_, &s) != ESP_OK) {
+            return std::nullopt;
+        }
+        return s;
+    }
+
+    /**
+     * @brief Current CO2 concentration, or std::nullopt if no sample yet or the line is not healthy
+     */
+    std::optional<uint32_t> ppm() const
+    {
+        cj202_sample_t s;
+        if (cj202_get_sample(handle_, &s) != ESP_OK || s.health != CJ202_HEALTH_OK) {
+            return std::nullopt;
+        }
+        return s.ppm;
+    }
+
+    /**
+     * @brief CO2 rate of change in ppm/min, or std::nullopt if not available
+     */
+    std::optional<int32_t> trend() const
+    {
+        int32_t slope;
+        if (cj202_get_trend(handle_, &slope) != ESP_OK) {
+            return std::nullopt;
+        }
+        return slope;
+    }
+
+    cj202_health_t health() const
+    {
+        return cj202_get_health(handle_);
+    }
+
+    /**
+     * @brief Save persisted state now, e.g. before deep sleep
+     */
+    esp_err_t persist_flush()
+    {
+        return cj202_persist_flush(handle_);
+    }
+
+    /**
+     * @brief Register an event callback
+     *
+     * Accepts any callable taking `const cj202_event_t &`. The callable is kept
+     * at a stable address, so moving the Sensor does not invalidate it. It runs
+     * in the driver's task context. The previous callable is destroyed only
+     * after the driver has returned from any call to it; do not call this from
+     * the callback itself.
+     */
+    template <typename F>
+    esp_err_t on_event(F &&callback)
+    {
+        auto holder = std::make_unique<EventCallback>(std::forward<F>(callback));
+        esp_err_t ret = cj202_register_event_callback(handle_, &Sensor::dispatch, holder.get());
+        if (ret == ESP_OK) {
+            // Registration waits out calls to the old callable, so it can go now
+            callback_ = std::move(holder);
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Unregister the event callback
+     *
+     * Not from the callback itself, see on_event().
+     */
+    esp_err_t clear_event_callback()
+    {
+        esp_err_t ret = cj202_register_event_callback(handle_, nullptr, nullptr);
+        if (ret == ESP_OK) {
+            callback_.reset();
+        }
+        return ret;
+    }
+
+    cj202_handle_t native_handle() const
+    {
+        return handle_;
+    }
+
+private:
+    explicit Sensor(cj202_handle_t handle) : handle_(handle) {}
+
+    static void dispatch(cj202_handle_t, const cj202_event_t *event, void *user_ctx)
+    {
+        (*static_cast<EventCallback *>(user_ctx))(*event);
+    }
+
+    void reset()
+    {
+        if (handle_ != nullptr) {
+            cj202_deinit(handle_);
+            handle_ = nullptr;
+        }
+        callback_.reset();
+    }
+
+    cj202_handle_t handle_ = nullptr;
+    std::unique_ptr<EventCallback> callback_;
+};
+
+} // namespace cj202
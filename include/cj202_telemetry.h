@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compact binary telemetry frames for CO2 samples.
+ *
+ * Frame layout:
+ *   magic (0xC2), version, varint base timestamp (ms)
+ *   then per record, until the end of the frame:
+ *     varint (channel << 3 | quality)
+ *     zigzag varint (interval - previous interval) of that channel, in ms
+ *     zigzag varint (ppm - previous ppm) of that channel
+ *
+ * A channel's first record uses the base timestamp as previous time and 0 as
+ * previous interval and ppm. At one sample per second and slowly varying CO2
+ * most records take 3 bytes.
+ *
+ * This file and cj202_telemetry.c only depend on the C library and esp_err.h,
+ * so the decoder also builds on the host.
+ */
+
+#define CJ202_TELEMETRY_MAGIC 0xC2
+#define CJ202_TELEMETRY_VERSION 1
+
+#define CJ202_TELEMETRY_MAX_CHANNELS 8   /*!< Sensors per frame, fixed by the frame format version */
+
+/**
+ * @brief Maximum encoded size of one record
+ */
+#define CJ202_TELEMETRY_RECORD_MAX_SIZE 16
+
+/**
+ * @brief Telemetry record
+ */
+typedef struct {
+    uint8_t channel;               /*!< Sensor index within the frame (< CJ202_TELEMETRY_MAX_CHANNELS) */
+    uint8_t quality;               /*!< Quality bits (0-7), e.g. a cj202_health_t value */
+    int64_t timestamp_ms;          /*!< Sample time, non-decreasing per channel */
+    uint32_t ppm;                  /*!< CO2 concentration */
+} cj202_telemetry_record_t;
+
+/**
+ * @brief Per-channel delta state
+ */
+typedef struct {
+    int64_t last_ms;               /*!< Timestamp of the channel's previous record */
+    int64_t last_interval_ms;      /*!< Interval before the channel's previous record */
+    uint32_t last_ppm;             /*!< ppm of the channel's previous record */
+} cj202_telemetry_channel_t;
+
+/**
+ * @brief Telemetry frame encoder
+ *
+ * Writes into a caller-supplied buffer, no allocation.
+ */
+typedef struct {
+    uint8_t *buf;                  /*!< Frame buffer */
+    size_t size;                   /*!< Frame buffer size */
+    size_t len;                    /*!< Bytes written so far, the frame length */
+    uint32_t count;                /*!< Records written so far */
+    int64_t base_ms;               /*!< Frame base timestamp */
+    cj202_telemetry_channel_t chan[CJ202_TELEMETRY_MAX_CHANNELS]; /*!< Delta state per channel */
+} cj202_telemetry_encoder_t;
+
+/**
+ * @brief Record callback used by cj202_telemetry_decode()
+ *
+ * @param record Decoded record
+ * @param user_ctx User context passed to cj202_telemetry_decode()
+ */
+typedef void (*cj202_telemetry_record_cb_t)(const cj202_telemetry_record_t *record, void *user_ctx);
+
+/**
+ * @brief Start a frame
+ *
+ * @param enc Encoder
+ * @param buf Frame buffer
+ * @param size Frame buffer size
+ * @param base_ms Base timestamp, no record may be older
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_ARG: bad argument, ESP_ERR_INVALID_SIZE: buffer too small for the header
+ */
+esp_err_t cj202_telemetry_encoder_init(cj202_telemetry_encoder_t *enc, uint8_t *buf, size_t size, int64_t base_ms);
+
+/**
+ * @brief Append a record to the frame
+ *
+ * On failure the frame is left unchanged, so a full frame can be sent and the
+ * record added to the next one.
+ *
+ * @param enc Encoder
+ * @param record Record to append
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_SIZE: frame full, ESP_ERR_INVALID_ARG: bad channel, quality or timestamp
+ */
+esp_err_t cj202_telemetry_encode(cj202_telemetry_encoder_t *enc, const cj202_telemetry_record_t *record);
+
+/**
+ * @brief Decode a frame
+ *
+ * @param frame Frame data
+ * @param len Frame length
+ * @param cb Called for each record in order
+ * @param user_ctx User context passed to cb
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_VERSION: unknown magic or version, ESP_ERR_INVALID_SIZE: truncated or malformed frame
+ */
+esp_err_t cj202_telemetry_decode(const uint8_t *frame, size_t len, cj202_telemetry_record_cb_t cb, void *user_ctx);
+
+#ifdef __cplusplus
+}
+#endif
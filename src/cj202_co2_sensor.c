@@ -26,11 +26,53 @@ esp_err_t cj202_init(const cj202_config_t *config, cj202_handle_t *handle)
     dev->mode = config->mode;
     dev->intr_alloc_flags = config->intr_alloc_flags;
     dev->co2_ppm = 0;
+    portMUX_INITIALIZE(&dev->lock);
+
+    esp_err_t ret = cj202_conversion_init(dev, &config->range);
+    if (ret != ESP_OK) {
+        free(dev);
+        return ret;
+    }
+
+    ret = cj202_trend_init(dev, &config->trend);
+    if (ret != ESP_OK) {
+        free(dev);
+        return ret;
+    }
+
+    ret = cj202_persist_init(dev, &config->persist);
+    if (ret != ESP_OK) {
+        free(dev);
+        return ret;
+    }
+
+    ret = cj202_health_init(dev);
+    if (ret != ESP_OK) {
+        cj202_persist_deinit(dev);
+        free(dev);
+        return ret;
+    }
+
+#if CONFIG_CJ202_SIMULATOR
+    ret = cj202_sim_init(dev, &config->sim);
+    if (ret != ESP_OK) {
+        cj202_health_deinit(dev);
+        cj202_persist_deinit(dev);
+        free(dev);
+        return ret;
+    }
+#else
+    if (config->sim.enable) {
+        ESP_LOGE(TAG, "Simulated input requires CONFIG_CJ202_SIMULATOR");
+        cj202_health_deinit(dev);
+        cj202_persist_deinit(dev);
+        free(dev);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+#endif
 
     ESP_LOGI(TAG, "Initializing CJ202 CO2 sensor, mode: %d, GPIO: %d", dev->mode, dev->gpio_num);
 
-    esp_err_t ret = ESP_OK;
-    
     // Initialize based on capture mode
     switch (dev->mode) {
         case CJ202_MODE_GPIO_INTERRUPT:
@@ -47,7 +89,22 @@ esp_err_t cj202_init(const cj202_config_t *config, cj202_handle_t *handle)
             break;
     }
 
+#if CONFIG_CJ202_SIMULATOR
+    if (ret == ESP_OK) {
+        ret = cj202_sim_start(dev);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start simulated input: %s", esp_err_to_name(ret));
+            cj202_deinit(dev);
+            return ret;
+        }
+    } else {
+        cj202_sim_deinit(dev);
+    }
+#endif
+
     if (ret != ESP_OK) {
+        cj202_health_deinit(dev);
+        cj202_persist_deinit(dev);
         free(dev);
         return ret;
     }
@@ -79,6 +136,145 @@ uint32_t cj202_get_ppm(cj202_handle_t handle)
     }
 }
 
+esp_err_t cj202_get_sample(cj202_handle_t handle, cj202_sample_t *sample)
+{
+    if (handle == NULL || sample == NULL) {
+        ESP_LOGE(TAG, "Handle or output is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cj202_dev_t *dev = (cj202_dev_t *)handle;
+
+    portENTER_CRITICAL(&dev->lock);
+    sample->ppm = dev->co2_ppm;
+    sample->timestamp_us = dev->sample_time_us;
+    sample->health = dev->health;
+    portEXIT_CRITICAL(&dev->lock);
+
+    return sample->timestamp_us != 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+cj202_health_t cj202_get_health(cj202_handle_t handle)
+{
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Handle is NULL");
+        return CJ202_HEALTH_DISCONNECTED;
+    }
+
+    return ((cj202_dev_t *)handle)->health;
+}
+
+esp_err_t cj202_get_trend(cj202_handle_t handle, int32_t *slope_ppm_per_min)
+{
+    if (handle == NULL || slope_ppm_per_min == NULL) {
+        ESP_LOGE(TAG, "Handle or output is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cj202_dev_t *dev = (cj202_dev_t *)handle;
+
+    if (dev->trend.config.window == 0 || dev->trend.count < 2) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *slope_ppm_per_min = dev->trend.slope_ppm_per_min;
+    return ESP_OK;
+}
+
+// Swap the callback pair and wait out calls that may still use the previous one
+static void cj202_set_event_callback(cj202_dev_t *dev, cj202_event_cb_t cb, void *user_ctx)
+{
+    uint32_t busy;
+
+    // Swap the pair atomically, cj202_emit_event() reads it under the same lock
+    portENTER_CRITICAL(&dev->lock);
+    dev->event_cb = cb;
+    dev->event_cb_ctx = user_ctx;
+    portEXIT_CRITICAL(&dev->lock);
+
+    // So the caller can free its context, and the capture task is not deleted inside the callback
+    do {
+        portENTER_CRITICAL(&dev->lock);
+        busy = dev->event_cb_busy;
+        portEXIT_CRITICAL(&dev->lock);
+        if (busy) {
+            vTaskDelay(1);
+        }
+    } while (busy);
+}
+
+esp_err_t cj202_register_event_callback(cj202_handle_t handle, cj202_event_cb_t cb, void *user_ctx)
+{
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Handle is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cj202_set_event_callback((cj202_dev_t *)handle, cb, user_ctx);
+    return ESP_OK;
+}
+
+esp_err_t cj202_persist_flush(cj202_handle_t handle)
+{
+    if (handle == NULL) {
+        ESP_LOGE(TAG, "Handle is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return cj202_persist_save((cj202_dev_t *)handle);
+}
+
+esp_err_t cj202_get_stats(cj202_handle_t handle, cj202_stats_t *stats)
+{
+    if (handle == NULL || stats == NULL) {
+        ESP_LOGE(TAG, "Handle or output is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+#if CONFIG_CJ202_STATS
+    cj202_dev_t *dev = (cj202_dev_t *)handle;
+    TaskHandle_t task = NULL;
+
+    switch (dev->mode) {
+        case CJ202_MODE_GPIO_INTERRUPT:
+            task = dev->gpio_task_handle;
+            break;
+#if !defined(CONFIG_IDF_TARGET_ESP32C2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+        case CJ202_MODE_MCPWM_CAPTURE:
+            task = dev->mcpwm_task_handle;
+            break;
+#endif
+        default:
+            break;
+    }
+
+    // Writers in the ISR and the capture task hold the same lock, so the 64-bit counters are never torn
+    portENTER_CRITICAL(&dev->lock);
+    *stats = dev->stats;
+    portEXIT_CRITICAL(&dev->lock);
+
+    stats->task_stack_free = task != NULL ? uxTaskGetStackHighWaterMark(task) : 0;
+    stats->task_runtime = 0;
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    if (task != NULL) {
+        TaskStatus_t status;
+        vTaskGetInfo(task, &status, pdFALSE, eRunning);
+        stats->task_runtime = status.ulRunTimeCounter;
+    }
+#endif
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// A timer that could not be deleted still references dev, leak it rather than free it under the timer
+static esp_err_t cj202_keep_device(cj202_dev_t *dev, esp_err_t err)
+{
+    ESP_LOGE(TAG, "GPIO %d: timer still active, not freeing the device", dev->gpio_num);
+    return err;
+}
+
 esp_err_t cj202_deinit(cj202_handle_t handle)
 {
     if (handle == NULL) {
@@ -89,6 +285,18 @@ esp_err_t cj202_deinit(cj202_handle_t handle)
     cj202_dev_t *dev = (cj202_dev_t *)handle;
     esp_err_t ret = ESP_OK;
 
+    // Events from the capture task run the callback there, let them return before
+    // the task is deleted; later ones see no callback
+    cj202_set_event_callback(dev, NULL, NULL);
+
+#if CONFIG_CJ202_SIMULATOR
+    // Stop edges before the capture task goes away
+    ret = cj202_sim_deinit(dev);
+    if (ret != ESP_OK) {
+        return cj202_keep_device(dev, ret);
+    }
+#endif
+
     // Deinitialize based on capture mode
     switch (dev->mode) {
         case CJ202_MODE_GPIO_INTERRUPT:
@@ -104,6 +312,20 @@ esp_err_t cj202_deinit(cj202_handle_t handle)
             break;
     }
 
+    esp_err_t timer_ret = cj202_health_deinit(dev);
+    if (timer_ret != ESP_OK) {
+        return cj202_keep_device(dev, timer_ret);
+    }
+
+    // Save state learned since the last interval, once no deferred save can run
+    timer_ret = cj202_persist_deinit(dev);
+    if (timer_ret != ESP_OK) {
+        return cj202_keep_device(dev, timer_ret);
+    }
+    if (dev->persist_ops != NULL) {
+        cj202_persist_save(dev);
+    }
+
     // Free device memory
     free(dev);
     return ret;
@@ -1,38 +1,197 @@
 #include <stdio.h>
 #include <inttypes.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "cj202_internal.h"
 
 static const char *TAG = "CJ202_COMMON";
 
-// CO2 sensor characteristics
-#define CO2_SENSOR_MIN_PPM 0
-#define CO2_SENSOR_MAX_PPM 5000
+// CO2 sensor defaults
+#define CO2_SENSOR_DEFAULT_RANGE_PPM 5000
+#define CO2_SENSOR_DEFAULT_HIGH_OFFSET_US 2000
+#define CO2_SENSOR_DEFAULT_PERIOD_OFFSET_US 4000
+
+/**
+ * @brief Precompute the PWM to CO2 conversion for a device
+ * 
+ * @param dev Device handle
+ * @param config Range configuration
+ * @return esp_err_t ESP_OK: success
+ */
+esp_err_t cj202_conversion_init(cj202_dev_t *dev, const cj202_range_config_t *config)
+{
+    cj202_conv_t *conv = &dev->conv;
+
+    if (config->range_ppm == 0) {
+        // Range left unset, the whole linear conversion takes the CJ202 defaults
+        conv->range_ppm = CO2_SENSOR_DEFAULT_RANGE_PPM;
+        conv->high_offset_us = CO2_SENSOR_DEFAULT_HIGH_OFFSET_US;
+        conv->period_offset_us = CO2_SENSOR_DEFAULT_PERIOD_OFFSET_US;
+    } else {
+        // Offsets are taken as given, 0 included (plain TH / period ratio)
+        conv->range_ppm = config->range_ppm;
+        conv->high_offset_us = config->high_offset_us;
+        conv->period_offset_us = config->period_offset_us;
+    }
+    conv->transfer_fn = config->transfer_fn;
+    conv->transfer_ctx = config->transfer_ctx;
+
+    for (int i = 0; i < CJ202_CONV_TABLE_SIZE; i++) {
+        uint32_t period_us = (CJ202_PERIOD_MIN_MS + i) * 1000;
+        conv->scale[i] = (uint32_t)(((uint64_t)conv->range_ppm << CJ202_CONV_SHIFT) / (period_us - conv->period_offset_us));
+    }
+
+    ESP_LOGD(TAG, "Conversion: range=%"PRIu32"ppm, offsets=%"PRIu32"/%"PRIu32"us%s",
+             conv->range_ppm, conv->high_offset_us, conv->period_offset_us,
+             conv->transfer_fn ? ", custom transfer function" : "");
+    return ESP_OK;
+}
 
 /**
  * @brief Calculate CO2 concentration
  * 
- * Formula: Cppm = 5000 × (TH-2ms) / (TH+TL-4ms)
+ * Formula: Cppm = range × (TH-high_offset) / (TH+TL-period_offset)
  * 
- * @param high_level_ms High level time in milliseconds
- * @param period_ms Period time in milliseconds
+ * @param dev Device handle
+ * @param high_level_us High level time in microseconds
+ * @param period_us Period time in microseconds
  * @return uint32_t CO2 concentration
  */
-uint32_t cj202_calculate_co2_ppm(uint32_t high_level_ms, uint32_t period_ms)
+uint32_t cj202_calculate_co2_ppm(const cj202_dev_t *dev, uint32_t high_level_us, uint32_t period_us)
 {
-    if (period_ms <= 4 || high_level_ms <= 2) {
+    const cj202_conv_t *conv = &dev->conv;
+
+    if (conv->transfer_fn != NULL) {
+        return conv->transfer_fn(high_level_us, period_us, conv->transfer_ctx);
+    }
+
+    if (period_us < CJ202_PERIOD_MIN_MS * 1000 || period_us > CJ202_PERIOD_MAX_MS * 1000 ||
+        high_level_us <= conv->high_offset_us) {
         return 0; // Invalid data
     }
 
-    // Apply formula: Cppm = 5000 × (TH-2ms) / (TH+TL-4ms)
-    float co2 = 5000.0f * (high_level_ms - 2.0f) / (period_ms - 4.0f);
+    // Interpolate between the 1ms table entries; divisions by a constant compile to multiplies
+    uint32_t index = period_us / 1000 - CJ202_PERIOD_MIN_MS;
+    uint32_t frac_us = period_us % 1000;
+    uint64_t scale = conv->scale[index];
+    if (frac_us != 0) {
+        scale -= (conv->scale[index] - conv->scale[index + 1]) * frac_us / 1000;
+    }
+
+    uint64_t co2 = ((high_level_us - conv->high_offset_us) * scale + (1ULL << (CJ202_CONV_SHIFT - 1))) >> CJ202_CONV_SHIFT;
 
-    // Limit range to 0-5000ppm
-    if (co2 < CO2_SENSOR_MIN_PPM) co2 = CO2_SENSOR_MIN_PPM;
-    if (co2 > CO2_SENSOR_MAX_PPM) co2 = CO2_SENSOR_MAX_PPM;
+    // Limit range to 0-range_ppm
+    if (co2 > conv->range_ppm) co2 = conv->range_ppm;
 
-    ESP_LOGD(TAG, "Calculate CO2: high_level=%"PRIu32"ms, period=%"PRIu32"ms, CO2=%"PRIu32"ppm", 
-             high_level_ms, period_ms, (uint32_t)co2);
+    ESP_LOGD(TAG, "Calculate CO2: high_level=%"PRIu32"us, period=%"PRIu32"us, CO2=%"PRIu32"ppm", 
+             high_level_us, period_us, (uint32_t)co2);
     
     return (uint32_t)co2;
-} 
\ No newline at end of file
+}
+
+/**
+ * @brief Publish a new CO2 sample
+ * 
+ * @param dev Device handle
+ * @param ppm CO2 concentration
+ * @param high_us High level time of the cycle that produced the sample
+ * @param period_us PWM period of the cycle that produced the sample
+ */
+void cj202_publish_ppm(cj202_dev_t *dev, uint32_t ppm, uint32_t high_us, uint32_t period_us)
+{
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&dev->lock);
+    dev->co2_ppm = ppm;
+    dev->sample_time_us = now;
+    dev->learned_period_us = period_us;
+#if CONFIG_CJ202_STATS
+    uint32_t latency_us = (uint32_t)(now - dev->pulse_end_us);
+    dev->stats.samples++;
+    dev->stats.latency_us_total += latency_us;
+    if (latency_us > dev->stats.latency_us_max) {
+        dev->stats.latency_us_max = latency_us;
+    }
+#endif
+    portEXIT_CRITICAL(&dev->lock);
+
+    cj202_health_cycle_valid(dev);
+    cj202_trend_update(dev, ppm, period_us);
+    cj202_persist_sample(dev, high_us, period_us);
+}
+
+/**
+ * @brief Deliver an event to the registered callback, if any
+ * 
+ * @param dev Device handle
+ * @param event Event to deliver
+ */
+void cj202_emit_event(cj202_dev_t *dev, cj202_event_t *event)
+{
+    cj202_event_cb_t cb;
+    void *ctx;
+
+    // Read the callback and its context as a pair, the callback itself runs unlocked
+    portENTER_CRITICAL(&dev->lock);
+    cb = dev->event_cb;
+    ctx = dev->event_cb_ctx;
+    if (cb != NULL) {
+        dev->event_cb_busy++;
+    }
+    event->ppm = dev->co2_ppm;
+    event->slope_ppm_per_min = dev->trend.slope_ppm_per_min;
+    event->health = dev->health;
+    portEXIT_CRITICAL(&dev->lock);
+
+    if (cb != NULL) {
+        cb(dev, event, ctx);
+
+        portENTER_CRITICAL(&dev->lock);
+        dev->event_cb_busy--;
+        portEXIT_CRITICAL(&dev->lock);
+    }
+}
+
+/**
+ * @brief Stop and delete a device timer whose callback may be running
+ *
+ * esp_timer_stop() does not wait for a running callback, which can re-arm the
+ * timer or still use the device. The stopping flag keeps new callbacks out,
+ * the running flag tells when the last one has returned.
+ *
+ * @param dev Device handle
+ * @param timer Timer to delete, set to NULL on success
+ * @param stopping Flag the callback checks before running
+ * @param running Flag the callback holds while running
+ * @return esp_err_t ESP_OK: success, others: the timer could not be deleted
+ */
+esp_err_t cj202_timer_teardown(cj202_dev_t *dev, esp_timer_handle_t *timer, bool *stopping, const bool *running)
+{
+    bool busy;
+
+    if (*timer == NULL) {
+        return ESP_OK;
+    }
+
+    portENTER_CRITICAL(&dev->lock);
+    *stopping = true;
+    portEXIT_CRITICAL(&dev->lock);
+
+    do {
+        portENTER_CRITICAL(&dev->lock);
+        busy = *running;
+        portEXIT_CRITICAL(&dev->lock);
+        if (busy) {
+            vTaskDelay(1);
+        }
+    } while (busy);
+
+    // No callback runs or re-arms from here on
+    esp_timer_stop(*timer);
+    esp_err_t ret = esp_timer_delete(*timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *timer = NULL;
+    return ESP_OK;
+}
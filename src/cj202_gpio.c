@@ -11,32 +11,57 @@
 
 static const char *TAG = "CJ202_GPIO";
 
-// Interrupt service routine
-static void IRAM_ATTR gpio_isr_handler(void* arg)
+// Edge handling, shared by the ISR and the simulator
+bool IRAM_ATTR cj202_gpio_edge(cj202_dev_t *dev, int level, int64_t now_us)
 {
-    cj202_dev_t *dev = (cj202_dev_t *)arg;
-    uint64_t current_time = esp_timer_get_time() / 1000; // Convert to milliseconds
-    int gpio_level = gpio_get_level(dev->gpio_num);
+#if CONFIG_CJ202_STATS
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    int64_t pulse_end_us = 0;
+#endif
+    uint64_t current_time = now_us;
     uint8_t gpio_num = dev->gpio_num;
+    BaseType_t high_task_wakeup = pdFALSE;
     
-    if (gpio_level == 1) {
+    dev->edge_count++;
+    
+    if (level == 1) {
         // Rising edge
         dev->rising_time = current_time;
-        if (dev->falling_time > 0) {
-            // Calculate period time
-            dev->period_time_ms = current_time - dev->falling_time + dev->high_level_time_ms;
+        if (dev->falling_time > 0 && dev->high_level_time_us > 0) {
+            // Calculate period time, once a full high pulse has been seen so a line
+            // that is high at boot does not yield a short first period
+            dev->period_time_us = current_time - dev->falling_time + dev->high_level_time_us;
         }
     } else {
         // Falling edge
         dev->falling_time = current_time;
         if (dev->rising_time > 0) {
             // Calculate high level time
-            dev->high_level_time_ms = current_time - dev->rising_time;
+            dev->high_level_time_us = current_time - dev->rising_time;
             dev->measurement_ready = true;
         }
+#if CONFIG_CJ202_STATS
+        pulse_end_us = now_us;
+#endif
     }
     
-    xQueueSendFromISR(dev->gpio_evt_queue, &gpio_num, NULL);
+    xQueueSendFromISR(dev->gpio_evt_queue, &gpio_num, &high_task_wakeup);
+
+#if CONFIG_CJ202_STATS
+    cj202_stats_edge(dev, start_cycles, pulse_end_us);
+#endif
+    return high_task_wakeup == pdTRUE;
+}
+
+// Interrupt service routine
+static void IRAM_ATTR gpio_isr_handler(void* arg)
+{
+    cj202_dev_t *dev = (cj202_dev_t *)arg;
+    
+    if (cj202_gpio_edge(dev, gpio_get_level(dev->gpio_num), esp_timer_get_time())) {
+        // Let the GPIO task publish right away instead of at the next tick
+        portYIELD_FROM_ISR();
+    }
 }
 
 // GPIO task
@@ -51,8 +76,12 @@ static void cj202_gpio_task(void* arg)
         if (xQueueReceive(dev->gpio_evt_queue, &io_num, portMAX_DELAY)) {
             if (dev->measurement_ready) {
                 // Verify period is within expected range (1004ms ±5%)
-                if (dev->period_time_ms >= 950 && dev->period_time_ms <= 1050) {
-                    dev->co2_ppm = cj202_calculate_co2_ppm(dev->high_level_time_ms, dev->period_time_ms);
+                if (dev->period_time_us >= CJ202_PERIOD_MIN_MS * 1000 && dev->period_time_us <= CJ202_PERIOD_MAX_MS * 1000) {
+                    cj202_publish_ppm(dev, cj202_calculate_co2_ppm(dev, dev->high_level_time_us, dev->period_time_us),
+                                      dev->high_level_time_us, dev->period_time_us);
+                } else if (dev->period_time_us > 0) {
+                    // Period is 0 until the first full cycle has been seen
+                    cj202_health_cycle_invalid(dev);
                 }
                 dev->measurement_ready = false;
             }
@@ -60,29 +89,9 @@ static void cj202_gpio_task(void* arg)
     }
 }
 
-// Initialize CO2 sensor with GPIO method
-esp_err_t cj202_gpio_init(cj202_dev_t *dev)
+// Configure the pin and attach the edge interrupt
+static esp_err_t cj202_gpio_attach(cj202_dev_t *dev)
 {
-    if (dev == NULL) {
-        ESP_LOGE(TAG, "Device handle is NULL");
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    // Initialize device state
-    dev->rising_time = 0;
-    dev->falling_time = 0;
-    dev->measurement_ready = false;
-    dev->high_level_time_ms = 0;
-    dev->period_time_ms = 0;
-    dev->co2_ppm = 0;
-    
-    // Create queue to handle gpio events
-    dev->gpio_evt_queue = xQueueCreate(10, sizeof(uint32_t));
-    if (dev->gpio_evt_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to create queue");
-        return ESP_FAIL;
-    }
-    
     // Configure GPIO
     gpio_config_t io_conf = {
         .intr_type = GPIO_INTR_ANYEDGE,   // Trigger on both rising and falling edges
@@ -96,8 +105,6 @@ esp_err_t cj202_gpio_init(cj202_dev_t *dev)
     esp_err_t ret = gpio_config(&io_conf);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "GPIO config failed");
-        vQueueDelete(dev->gpio_evt_queue);
-        dev->gpio_evt_queue = NULL;
         return ret;
     }
     
@@ -106,8 +113,6 @@ esp_err_t cj202_gpio_init(cj202_dev_t *dev)
     if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
         // ESP_ERR_INVALID_STATE means ISR service is already installed, not an error
         ESP_LOGE(TAG, "ISR service install failed");
-        vQueueDelete(dev->gpio_evt_queue);
-        dev->gpio_evt_queue = NULL;
         return ret;
     }
     
@@ -115,6 +120,45 @@ esp_err_t cj202_gpio_init(cj202_dev_t *dev)
     ret = gpio_isr_handler_add(dev->gpio_num, gpio_isr_handler, dev);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "ISR handler add failed");
+        return ret;
+    }
+    dev->gpio_attached = true;
+    
+    return ESP_OK;
+}
+
+// Initialize CO2 sensor with GPIO method
+esp_err_t cj202_gpio_init(cj202_dev_t *dev)
+{
+    if (dev == NULL) {
+        ESP_LOGE(TAG, "Device handle is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Initialize device state
+    dev->rising_time = 0;
+    dev->falling_time = 0;
+    dev->measurement_ready = false;
+    dev->high_level_time_us = 0;
+    // A restored period lets the first high pulse produce a reading
+    dev->period_time_us = dev->learned_period_us;
+    
+    // Create queue to handle gpio events
+    dev->gpio_evt_queue = xQueueCreate(10, sizeof(uint32_t));
+    if (dev->gpio_evt_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create queue");
+        return ESP_FAIL;
+    }
+    
+    esp_err_t ret = ESP_OK;
+#if CONFIG_CJ202_SIMULATOR
+    // Edges come from the simulator, leave the pin alone
+    if (!dev->sim.enable)
+#endif
+    {
+        ret = cj202_gpio_attach(dev);
+    }
+    if (ret != ESP_OK) {
         vQueueDelete(dev->gpio_evt_queue);
         dev->gpio_evt_queue = NULL;
         return ret;
@@ -124,7 +168,10 @@ esp_err_t cj202_gpio_init(cj202_dev_t *dev)
     BaseType_t task_ret = xTaskCreate(cj202_gpio_task, "cj202_gpio_task", 3072, dev, 10, &dev->gpio_task_handle);
     if (task_ret != pdPASS) {
         ESP_LOGE(TAG, "Task creation failed");
-        gpio_isr_handler_remove(dev->gpio_num);
+        if (dev->gpio_attached) {
+            gpio_isr_handler_remove(dev->gpio_num);
+            dev->gpio_attached = false;
+        }
         vQueueDelete(dev->gpio_evt_queue);
         dev->gpio_evt_queue = NULL;
         return ESP_FAIL;
@@ -153,10 +200,13 @@ esp_err_t cj202_gpio_deinit(cj202_dev_t *dev)
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Remove GPIO ISR handler
-    esp_err_t ret = gpio_isr_handler_remove(dev->gpio_num);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to remove ISR handler");
+    // Remove GPIO ISR handler, unless the pin was left to the simulator
+    if (dev->gpio_attached) {
+        esp_err_t ret = gpio_isr_handler_remove(dev->gpio_num);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to remove ISR handler");
+        }
+        dev->gpio_attached = false;
     }
     
     // Delete task if it exists
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "driver/gpio.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cj202_internal.h"
+
+static const char *TAG = "CJ202_HEALTH";
+
+#define HEALTH_DEADLINE_US ((uint64_t)CJ202_HEALTH_DEADLINE_MS * 1000)
+#define HEALTH_DISCONNECT_US ((int64_t)CONFIG_CJ202_HEALTH_DISCONNECT_MS * 1000)
+#define HEALTH_LOG_INTERVAL_US ((int64_t)CONFIG_CJ202_HEALTH_LOG_INTERVAL_MS * 1000)
+
+static const char *const health_names[] = {
+    [CJ202_HEALTH_OK] = "ok",
+    [CJ202_HEALTH_STALE] = "stale",
+    [CJ202_HEALTH_STUCK_HIGH] = "stuck high",
+    [CJ202_HEALTH_STUCK_LOW] = "stuck low",
+    [CJ202_HEALTH_OUT_OF_SPEC] = "period out of spec",
+    [CJ202_HEALTH_DISCONNECTED] = "disconnected",
+};
+
+// Log (rate limited) and publish a health change. Called without the lock held.
+static void cj202_health_report(cj202_dev_t *dev, cj202_health_t health)
+{
+    int64_t now = esp_timer_get_time();
+
+    if (dev->health_log_time_us == 0 || now - dev->health_log_time_us >= HEALTH_LOG_INTERVAL_US) {
+        esp_log_level_t level = health == CJ202_HEALTH_OK ? ESP_LOG_INFO : ESP_LOG_WARN;
+        if (dev->health_log_suppressed != 0) {
+            ESP_LOG_LEVEL(level, TAG, "GPIO %d: %s (%"PRIu32" earlier changes not logged)",
+                          dev->gpio_num, health_names[health], dev->health_log_suppressed);
+        } else {
+            ESP_LOG_LEVEL(level, TAG, "GPIO %d: %s", dev->gpio_num, health_names[health]);
+        }
+        dev->health_log_time_us = now;
+        dev->health_log_suppressed = 0;
+    } else {
+        dev->health_log_suppressed++;
+    }
+
+    cj202_event_t event = {
+        .type = CJ202_EVENT_HEALTH_CHANGED,
+    };
+    cj202_emit_event(dev, &event);
+}
+
+static void cj202_health_deadline(void *arg)
+{
+    cj202_dev_t *dev = (cj202_dev_t *)arg;
+    int64_t now = esp_timer_get_time();
+    int level;
+#if CONFIG_CJ202_SIMULATOR
+    level = dev->sim.enable ? dev->sim.level : gpio_get_level(dev->gpio_num);
+#else
+    level = gpio_get_level(dev->gpio_num);
+#endif
+    cj202_health_t health;
+    uint64_t next_us = 0;
+    bool changed;
+
+    portENTER_CRITICAL(&dev->lock);
+    if (dev->health_stopping || now - dev->health_last_valid_us < (int64_t)HEALTH_DEADLINE_US) {
+        // Being deinitialized, or a valid cycle re-armed the deadline while this callback was pending
+        portEXIT_CRITICAL(&dev->lock);
+        return;
+    }
+    dev->health_running = true;
+
+    uint32_t edges = dev->edge_count;
+    if (edges - dev->health_edge_mark == 1 && level) {
+        // Only a rising edge since the last valid cycle (or init) and the line is still high
+        dev->health_edge_mark = edges;
+        dev->health_last_edge_us = now;
+        health = CJ202_HEALTH_STUCK_HIGH;
+        next_us = HEALTH_DISCONNECT_US;
+    } else if (edges != dev->health_edge_mark) {
+        // Edges are arriving but not forming valid cycles
+        dev->health_edge_mark = edges;
+        dev->health_last_edge_us = now;
+        health = dev->health == CJ202_HEALTH_OUT_OF_SPEC ? CJ202_HEALTH_OUT_OF_SPEC : CJ202_HEALTH_STALE;
+        next_us = HEALTH_DEADLINE_US;
+    } else if (now - dev->health_last_edge_us >= HEALTH_DISCONNECT_US) {
+        // Idle for long enough, stop re-arming until edges return
+        health = CJ202_HEALTH_DISCONNECTED;
+    } else {
+        health = level ? CJ202_HEALTH_STUCK_HIGH : CJ202_HEALTH_STUCK_LOW;
+        next_us = HEALTH_DISCONNECT_US - (now - dev->health_last_edge_us);
+    }
+
+    changed = dev->health != health;
+    dev->health = health;
+    portEXIT_CRITICAL(&dev->lock);
+
+    if (next_us > 0) {
+        // Fails harmlessly if a valid cycle already re-armed the timer
+        esp_timer_start_once(dev->health_timer, next_us);
+    }
+
+    if (changed) {
+        cj202_health_report(dev, health);
+    }
+
+    portENTER_CRITICAL(&dev->lock);
+    dev->health_running = false;
+    portEXIT_CRITICAL(&dev->lock);
+}
+
+esp_err_t cj202_health_init(cj202_dev_t *dev)
+{
+    const esp_timer_create_args_t timer_args = {
+        .callback = cj202_health_deadline,
+        .arg = dev,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "cj202_health",
+    };
+
+    esp_err_t ret = esp_timer_create(&timer_args, &dev->health_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create health timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    // Count idle time from now, so a sensor that never toggles is flagged too
+    dev->health = CJ202_HEALTH_STALE;
+    dev->health_edge_mark = dev->edge_count;
+    dev->health_last_edge_us = esp_timer_get_time();
+    dev->health_last_valid_us = 0;
+    dev->health_log_time_us = 0;
+    dev->health_log_suppressed = 0;
+    dev->health_stopping = false;
+    dev->health_running = false;
+
+    ret = esp_timer_start_once(dev->health_timer, HEALTH_DEADLINE_US);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start health timer: %s", esp_err_to_name(ret));
+        esp_timer_delete(dev->health_timer);
+        dev->health_timer = NULL;
+        return ret;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t cj202_health_deinit(cj202_dev_t *dev)
+{
+    esp_err_t ret = cj202_timer_teardown(dev, &dev->health_timer, &dev->health_stopping, &dev->health_running);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete health timer: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+void cj202_health_cycle_valid(cj202_dev_t *dev)
+{
+    int64_t now = esp_timer_get_time();
+    bool changed;
+
+    portENTER_CRITICAL(&dev->lock);
+    dev->health_last_valid_us = now;
+    dev->health_last_edge_us = now;
+    dev->health_edge_mark = dev->edge_count;
+    changed = dev->health != CJ202_HEALTH_OK;
+    dev->health = CJ202_HEALTH_OK;
+    portEXIT_CRITICAL(&dev->lock);
+
+    esp_timer_stop(dev->health_timer);
+    esp_timer_start_once(dev->health_timer, HEALTH_DEADLINE_US);
+
+    if (changed) {
+        cj202_health_report(dev, CJ202_HEALTH_OK);
+    }
+}
+
+void cj202_health_cycle_invalid(cj202_dev_t *dev)
+{
+    bool changed;
+
+    portENTER_CRITICAL(&dev->lock);
+    changed = dev->health != CJ202_HEALTH_OUT_OF_SPEC;
+    dev->health = CJ202_HEALTH_OUT_OF_SPEC;
+    portEXIT_CRITICAL(&dev->lock);
+
+    // Re-arm if the line had been given up as disconnected
+    if (!esp_timer_is_active(dev->health_timer)) {
+        esp_timer_start_once(dev->health_timer, HEALTH_DEADLINE_US);
+    }
+
+    if (changed) {
+        cj202_health_report(dev, CJ202_HEALTH_OUT_OF_SPEC);
+    }
+}
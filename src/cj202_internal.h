@@ -5,12 +5,106 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#if CONFIG_CJ202_STATS
+#include "esp_cpu.h"
+#endif
 #include "cj202_co2_sensor.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// CO2 sensor PWM characteristics
+#define CJ202_PERIOD_NOMINAL_MS 1004   // Expected period: 1004ms ±5%
+#define CJ202_PERIOD_MIN_MS 950        // Minimum valid period (ms)
+#define CJ202_PERIOD_MAX_MS 1050       // Maximum valid period (ms)
+
+// Health deadline after the last valid cycle: 1.5 periods
+#define CJ202_HEALTH_DEADLINE_MS (CJ202_PERIOD_MAX_MS + CJ202_PERIOD_MAX_MS / 2)
+
+// Conversion table covers valid periods at 1ms steps
+#define CJ202_CONV_TABLE_SIZE (CJ202_PERIOD_MAX_MS - CJ202_PERIOD_MIN_MS + 1)
+#define CJ202_CONV_SHIFT 32
+
+/**
+ * @brief Precomputed PWM to CO2 conversion
+ *
+ * scale[i] = (range << CJ202_CONV_SHIFT) / (period_i - period_offset), where
+ * period_i = CJ202_PERIOD_MIN_MS + i. A sample costs two table lookups, a
+ * linear interpolation and one 64-bit multiply.
+ */
+typedef struct {
+    uint32_t range_ppm;                /*!< Full scale */
+    uint32_t high_offset_us;           /*!< High level offset */
+    uint32_t period_offset_us;         /*!< Period offset */
+    cj202_transfer_fn_t transfer_fn;   /*!< Optional custom conversion */
+    void *transfer_ctx;                /*!< User context for transfer_fn */
+    uint32_t scale[CJ202_CONV_TABLE_SIZE]; /*!< Fixed-point range / (period - offset), below 2^29 for 16-bit range and offset */
+} cj202_conv_t;
+
+/**
+ * @brief Trend detector state
+ */
+typedef enum {
+    CJ202_TREND_STEADY,                /*!< Slope inside the thresholds */
+    CJ202_TREND_RISING,                /*!< Occupancy onset reported */
+    CJ202_TREND_FALLING,               /*!< Ventilation event reported */
+} cj202_trend_state_t;
+
+/**
+ * @brief Incremental least-squares trend over a sliding sample window
+ *
+ * Samples are indexed 0..n-1 from oldest to newest, so the x sums are closed
+ * form and only the y sums are maintained.
+ */
+typedef struct {
+    cj202_trend_config_t config;       /*!< Trend configuration */
+    uint16_t ring[CONFIG_CJ202_TREND_WINDOW_MAX]; /*!< Sample ring, oldest at head once full */
+    uint8_t head;                      /*!< Index of the oldest sample */
+    uint8_t count;                     /*!< Samples currently in the window */
+    int64_t sum_y;                     /*!< Sum of samples */
+    int64_t sum_xy;                    /*!< Sum of index times sample */
+    int32_t slope_ppm_per_min;         /*!< Last computed slope */
+    cj202_trend_state_t state;         /*!< Event detector state */
+} cj202_trend_t;
+
+/**
+ * @brief Persisted sensor state
+ *
+ * `hash` covers every field before `saved_at_s`, so it both validates the blob
+ * and tells whether the state changed since the last write.
+ */
+typedef struct {
+    uint8_t version;                   /*!< CJ202_PERSIST_VERSION */
+    uint8_t mode;                      /*!< Capture mode the state was learned with */
+    uint16_t range_ppm;                /*!< Range the samples were converted with */
+    uint32_t ppm;                      /*!< Last good sample */
+    uint32_t learned_period_us;        /*!< Period of the last valid cycle */
+    cj202_trend_t trend;               /*!< Trend window, sums and detector state */
+    int64_t saved_at_s;                /*!< System time of the save, in seconds */
+    uint32_t hash;                     /*!< FNV-1a of the fields above saved_at_s */
+} cj202_snapshot_t;
+
+#define CJ202_PERSIST_VERSION 1
+
+#if CONFIG_CJ202_SIMULATOR
+/**
+ * @brief Simulated PWM source state
+ */
+typedef struct {
+    bool enable;                       /*!< Sensor is driven by the simulator */
+    int level;                         /*!< Current simulated line level */
+    uint32_t high_us;                  /*!< Simulated high level time */
+    uint32_t low_us;                   /*!< Simulated low level time */
+    uint32_t ticks_per_us;             /*!< MCPWM capture ticks per microsecond */
+    esp_timer_handle_t timer;          /*!< Edge timer */
+    bool stopping;                     /*!< Deinit started, the edge timer must not re-arm */
+    bool running;                      /*!< Edge callback in progress */
+} cj202_sim_t;
+#endif
+
 /**
  * @brief CJ202 CO2 sensor device structure
  */
@@ -19,25 +113,63 @@ typedef struct cj202_dev_t {
     cj202_capture_mode_t mode;         /*!< Capture mode */
     uint32_t co2_ppm;                  /*!< Current CO2 concentration in ppm */
     int intr_alloc_flags;              /*!< Optional Interrupt allocation flags */
+    cj202_conv_t conv;                 /*!< PWM to CO2 conversion */
+    cj202_trend_t trend;               /*!< CO2 trend state */
+    cj202_event_cb_t event_cb;         /*!< Event callback */
+    void *event_cb_ctx;                /*!< Event callback user context */
+    uint32_t event_cb_busy;            /*!< Event callback calls in progress */
+    portMUX_TYPE lock;                 /*!< Protects sample, trend window and health state */
+    int64_t sample_time_us;            /*!< Publish time of co2_ppm, 0 before the first sample */
+    uint32_t learned_period_us;        /*!< Period of the last valid cycle, restored across reboots */
+
+    // State persistence
+    const cj202_persist_ops_t *persist_ops; /*!< Storage backend, NULL when persistence is disabled */
+    uint32_t persist_pending;          /*!< Valid samples since the last save */
+    uint32_t persist_hash;             /*!< Hash of the last snapshot written */
+    esp_timer_handle_t persist_timer;  /*!< Deferred save */
+    bool persist_stopping;             /*!< Deinit started, deferred saves are skipped */
+    bool persist_running;              /*!< Deferred save in progress */
+
+    // Line health
+    esp_timer_handle_t health_timer;   /*!< One-shot health deadline */
+    volatile uint32_t edge_count;      /*!< Edges seen by the capture ISR */
+    uint32_t health_edge_mark;         /*!< edge_count when the deadline was last armed */
+    int64_t health_last_valid_us;      /*!< Time of the last valid cycle */
+    int64_t health_last_edge_us;       /*!< Time edges were last known to be arriving */
+    cj202_health_t health;             /*!< Current line health */
+    int64_t health_log_time_us;        /*!< Time of the last health log message */
+    uint32_t health_log_suppressed;    /*!< Health changes not logged since then */
+    bool health_stopping;              /*!< Deinit started, the deadline must not re-arm */
+    bool health_running;               /*!< Deadline callback in progress */
+
+#if CONFIG_CJ202_STATS
+    cj202_stats_t stats;               /*!< Driver statistics */
+    int64_t pulse_end_us;              /*!< Time of the last falling edge */
+#endif
+#if CONFIG_CJ202_SIMULATOR
+    cj202_sim_t sim;                   /*!< Simulated PWM source */
+#endif
     
     // GPIO specific data
     QueueHandle_t gpio_evt_queue;      /*!< GPIO event queue */
     TaskHandle_t gpio_task_handle;     /*!< GPIO task handle */
-    uint64_t rising_time;              /*!< Rising edge timestamp (ms) */
-    uint64_t falling_time;             /*!< Falling edge timestamp (ms) */
+    uint64_t rising_time;              /*!< Rising edge timestamp (us) */
+    uint64_t falling_time;             /*!< Falling edge timestamp (us) */
     bool measurement_ready;            /*!< Flag indicating if measurement is ready */
-    uint32_t high_level_time_ms;       /*!< High level time in milliseconds */
-    uint32_t period_time_ms;           /*!< Period time in milliseconds */
+    uint32_t high_level_time_us;       /*!< High level time in microseconds */
+    uint32_t period_time_us;           /*!< Period time in microseconds */
+    bool gpio_attached;                /*!< ISR handler added for gpio_num */
     
 #if !defined(CONFIG_IDF_TARGET_ESP32C2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
     // MCPWM specific data
     TaskHandle_t mcpwm_task_handle;    /*!< MCPWM task handle */
     void *cap_timer;                   /*!< MCPWM capture timer handle */
     void *cap_chan;                    /*!< MCPWM capture channel handle */
-    uint32_t prev_high_ticks;          /*!< Previous high level ticks */
-    uint32_t prev_period_ticks;        /*!< Previous period ticks */
+    uint32_t cap_val_begin;            /*!< Capture value of the last positive edge */
+    bool pos_edge_captured;            /*!< Positive edge seen, waiting for the negative one */
     bool first_measurement;            /*!< Flag for first measurement */
-    uint32_t last_capture_time;        /*!< Last capture timestamp */
+    int64_t last_capture_time;         /*!< Last capture timestamp (us) */
+    uint64_t ticks_to_us;              /*!< Capture ticks to us, fixed point with CJ202_CONV_SHIFT */
 #endif
 } cj202_dev_t;
 
@@ -49,6 +181,18 @@ typedef struct cj202_dev_t {
  */
 esp_err_t cj202_gpio_init(cj202_dev_t *dev);
 
+/**
+ * @brief Handle a PWM edge (GPIO mode)
+ * 
+ * Called from the GPIO ISR, or from the simulator.
+ * 
+ * @param dev Device handle
+ * @param level Line level after the edge
+ * @param now_us Edge timestamp (esp_timer time)
+ * @return true if a higher priority task was woken
+ */
+bool cj202_gpio_edge(cj202_dev_t *dev, int level, int64_t now_us);
+
 /**
  * @brief Get current CO2 concentration (GPIO mode)
  * 
@@ -74,6 +218,18 @@ esp_err_t cj202_gpio_deinit(cj202_dev_t *dev);
  */
 esp_err_t cj202_mcpwm_init(cj202_dev_t *dev);
 
+/**
+ * @brief Handle a PWM edge (MCPWM mode)
+ * 
+ * Called from the MCPWM capture callback, or from the simulator.
+ * 
+ * @param dev Device handle
+ * @param pos_edge true for a rising edge
+ * @param cap_value Capture timer value at the edge
+ * @return true if a higher priority task was woken
+ */
+bool cj202_mcpwm_edge(cj202_dev_t *dev, bool pos_edge, uint32_t cap_value);
+
 /**
  * @brief Get current CO2 concentration (MCPWM mode)
  * 
@@ -91,16 +247,214 @@ uint32_t cj202_mcpwm_get_ppm(cj202_dev_t *dev);
 esp_err_t cj202_mcpwm_deinit(cj202_dev_t *dev);
 #endif
 
+/**
+ * @brief Precompute the PWM to CO2 conversion for a device
+ * 
+ * @param dev Device handle
+ * @param config Range configuration, a range_ppm of 0 selects the CJ202 defaults
+ * @return esp_err_t ESP_OK: success
+ */
+esp_err_t cj202_conversion_init(cj202_dev_t *dev, const cj202_range_config_t *config);
+
 /**
  * @brief Calculate CO2 concentration
  * 
- * Formula: Cppm = 5000 × (TH-2ms) / (TH+TL-4ms)
+ * Formula: Cppm = range × (TH-high_offset) / (TH+TL-period_offset)
  * 
- * @param high_level_ms High level time (milliseconds)
- * @param period_ms Period time (milliseconds)
+ * @param dev Device handle
+ * @param high_level_us High level time (microseconds)
+ * @param period_us Period time (microseconds), must be within the valid period range
  * @return uint32_t CO2 concentration
  */
-uint32_t cj202_calculate_co2_ppm(uint32_t high_level_ms, uint32_t period_ms);
+uint32_t cj202_calculate_co2_ppm(const cj202_dev_t *dev, uint32_t high_level_us, uint32_t period_us);
+
+/**
+ * @brief Publish a new CO2 sample
+ *
+ * Stores the sample as the current reading and feeds the trend detector.
+ * Called from the capture task of each backend, right after the falling edge.
+ *
+ * @param dev Device handle
+ * @param ppm CO2 concentration
+ * @param high_us High level time of the cycle that produced the sample
+ * @param period_us PWM period of the cycle that produced the sample
+ */
+void cj202_publish_ppm(cj202_dev_t *dev, uint32_t ppm, uint32_t high_us, uint32_t period_us);
+
+/**
+ * @brief Restore persisted state into a device
+ *
+ * Called from cj202_init() before the capture backend starts.
+ *
+ * @param dev Device handle
+ * @param config Persistence configuration
+ * @return esp_err_t ESP_OK: success or nothing to restore, others: failed
+ */
+esp_err_t cj202_persist_init(cj202_dev_t *dev, const cj202_persist_config_t *config);
+
+/**
+ * @brief Stop deferred saves
+ *
+ * Waits for a deferred save in progress. Safe to call with persistence disabled.
+ *
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, others: the timer could not be deleted
+ */
+esp_err_t cj202_persist_deinit(cj202_dev_t *dev);
+
+/**
+ * @brief Count a published sample and schedule a save when the interval is reached
+ *
+ * The save runs later from the esp_timer task, placed away from the next edges:
+ * flash writes disable the cache and would delay non-IRAM capture interrupts.
+ *
+ * @param dev Device handle
+ * @param high_us High level time of the cycle just published
+ * @param period_us Period of the cycle just published
+ */
+void cj202_persist_sample(cj202_dev_t *dev, uint32_t high_us, uint32_t period_us);
+
+/**
+ * @brief Save a snapshot if it differs from the last one written
+ *
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, ESP_ERR_NOT_SUPPORTED: persistence disabled, others: storage error
+ */
+esp_err_t cj202_persist_save(cj202_dev_t *dev);
+
+/**
+ * @brief Deliver an event to the registered callback, if any
+ *
+ * @param dev Device handle
+ * @param event Event to deliver, `ppm`, `slope_ppm_per_min` and `health` are filled in here
+ */
+void cj202_emit_event(cj202_dev_t *dev, cj202_event_t *event);
+
+/**
+ * @brief Stop and delete a device timer whose callback may be running
+ *
+ * Sets `*stopping` under the device lock, waits for `*running` to clear, then
+ * stops and deletes the timer. The callback must check `*stopping` and set
+ * `*running` under the lock before it touches the timer, and clear `*running`
+ * when done. Does nothing if `*timer` is NULL.
+ *
+ * @param dev Device handle
+ * @param timer Timer to delete, set to NULL on success
+ * @param stopping Flag the callback checks before running
+ * @param running Flag the callback holds while running
+ * @return esp_err_t ESP_OK: success, others: the timer could not be deleted and still references dev
+ */
+esp_err_t cj202_timer_teardown(cj202_dev_t *dev, esp_timer_handle_t *timer, bool *stopping, const bool *running);
+
+/**
+ * @brief Create the health deadline timer and arm it
+ *
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, others: failed
+ */
+esp_err_t cj202_health_init(cj202_dev_t *dev);
+
+/**
+ * @brief Stop and delete the health deadline timer
+ *
+ * Waits for a deadline callback in progress, so it must not be called from the
+ * event callback.
+ *
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, others: the timer could not be deleted
+ */
+esp_err_t cj202_health_deinit(cj202_dev_t *dev);
+
+/**
+ * @brief Report a valid PWM cycle: health becomes OK and the deadline is re-armed
+ *
+ * @param dev Device handle
+ */
+void cj202_health_cycle_valid(cj202_dev_t *dev);
+
+/**
+ * @brief Report a PWM cycle measured with a period out of spec
+ *
+ * @param dev Device handle
+ */
+void cj202_health_cycle_invalid(cj202_dev_t *dev);
+
+/**
+ * @brief Initialize trend state
+ *
+ * @param dev Device handle
+ * @param config Trend configuration
+ * @return esp_err_t ESP_OK: success, ESP_ERR_INVALID_ARG: window out of range
+ */
+esp_err_t cj202_trend_init(cj202_dev_t *dev, const cj202_trend_config_t *config);
+
+/**
+ * @brief Add a sample to the trend window and run event detection
+ *
+ * O(1) per sample, no allocation.
+ *
+ * @param dev Device handle
+ * @param ppm CO2 concentration
+ * @param period_us Sample period, used to convert the slope to ppm/min
+ */
+void cj202_trend_update(cj202_dev_t *dev, uint32_t ppm, uint32_t period_us);
+
+#if CONFIG_CJ202_STATS
+/**
+ * @brief Account one capture edge, call at the end of the edge handler
+ * 
+ * Runs in the capture ISR or the simulator callback, under the device lock so
+ * cj202_get_stats() and cj202_publish_ppm() never see a half-written 64-bit value.
+ * 
+ * @param dev Device handle
+ * @param start_cycles esp_cpu_get_cycle_count() at the start of the edge handler
+ * @param pulse_end_us Time of this edge if it ends a high pulse, 0 otherwise
+ */
+FORCE_INLINE_ATTR void cj202_stats_edge(cj202_dev_t *dev, uint32_t start_cycles, int64_t pulse_end_us)
+{
+    uint32_t cycles = esp_cpu_get_cycle_count() - start_cycles;
+
+    portENTER_CRITICAL_SAFE(&dev->lock);
+    if (pulse_end_us != 0) {
+        dev->pulse_end_us = pulse_end_us;
+    }
+    dev->stats.edges++;
+    dev->stats.isr_cycles += cycles;
+    if (cycles > dev->stats.isr_cycles_max) {
+        dev->stats.isr_cycles_max = cycles;
+    }
+    portEXIT_CRITICAL_SAFE(&dev->lock);
+}
+#endif
+
+#if CONFIG_CJ202_SIMULATOR
+/**
+ * @brief Set up the simulated PWM source
+ * 
+ * @param dev Device handle, range conversion must be initialized
+ * @param config Simulator configuration
+ * @return esp_err_t ESP_OK: success, others: failed
+ */
+esp_err_t cj202_sim_init(cj202_dev_t *dev, const cj202_sim_config_t *config);
+
+/**
+ * @brief Start generating edges, once the capture backend is ready
+ * 
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, others: failed
+ */
+esp_err_t cj202_sim_start(cj202_dev_t *dev);
+
+/**
+ * @brief Stop and delete the simulated PWM source
+ * 
+ * Waits for a running edge callback, so the capture backend can be torn down afterwards.
+ * 
+ * @param dev Device handle
+ * @return esp_err_t ESP_OK: success, others: the timer could not be deleted and still references dev
+ */
+esp_err_t cj202_sim_deinit(cj202_dev_t *dev);
+#endif
 
 #ifdef __cplusplus
 }
@@ -9,113 +9,93 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_private/esp_clk.h"
+#include "esp_timer.h"
 #include "driver/mcpwm_cap.h"
 #include "driver/gpio.h"
 
 static const char *TAG = "CJ202_MCPWM";
 
-// CO2 sensor characteristics
-#define CO2_SENSOR_PERIOD_MS 1004  // Expected period: 1004ms ±5%
-#define CO2_PERIOD_MIN_MS 950      // Minimum valid period (ms)
-#define CO2_PERIOD_MAX_MS 1050     // Maximum valid period (ms)
-#define CO2_CAPTURE_TIMEOUT_MS 1500 // Timeout for capture notification
 #define CO2_TASK_STACK_SIZE 4096   // Task stack size
 
-// Structure to hold capture values
-typedef struct {
-    uint32_t cap_val_begin;  // Timestamp of positive edge
-    uint32_t cap_val_end;    // Timestamp of negative edge
-    bool pos_edge_captured;  // Flag indicating if positive edge was captured
-} co2_capture_data_t;
-
-static bool co2_sensor_capture_callback(mcpwm_cap_channel_handle_t cap_chan, const mcpwm_capture_event_data_t *edata, void *user_data)
+// Edge handling, shared by the capture callback and the simulator
+bool IRAM_ATTR cj202_mcpwm_edge(cj202_dev_t *dev, bool pos_edge, uint32_t cap_value)
 {
-    cj202_dev_t *dev = (cj202_dev_t *)user_data;
-    static co2_capture_data_t co2_cap_data = {0};
+#if CONFIG_CJ202_STATS
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    int64_t pulse_end_us = 0;
+#endif
     BaseType_t high_task_wakeup = pdFALSE;
     uint32_t tof_ticks = 0;
 
-    // Edge detection logic
-    switch (edata->cap_edge) {
-    case MCPWM_CAP_EDGE_POS:
+    dev->edge_count++;
+
+    // Edge detection logic, capture state is per device so several sensors can run at once
+    if (pos_edge) {
         // Store the timestamp when positive edge is detected
-        co2_cap_data.cap_val_begin = edata->cap_value;
-        co2_cap_data.pos_edge_captured = true;
-        break;
+        dev->cap_val_begin = cap_value;
+        dev->pos_edge_captured = true;
+    } else if (dev->pos_edge_captured) {
+        dev->pos_edge_captured = false;
         
-    case MCPWM_CAP_EDGE_NEG:
-        if (co2_cap_data.pos_edge_captured) {
-            // Store the timestamp when negative edge is detected
-            co2_cap_data.cap_val_end = edata->cap_value;
-            co2_cap_data.pos_edge_captured = false;
-            
-            // Calculate high pulse width in ticks
-            if (co2_cap_data.cap_val_end > co2_cap_data.cap_val_begin) {
-                tof_ticks = co2_cap_data.cap_val_end - co2_cap_data.cap_val_begin;
-                // Notify the task to calculate the CO2 concentration
-                xTaskNotifyFromISR(dev->mcpwm_task_handle, tof_ticks, eSetValueWithOverwrite, &high_task_wakeup);
-            }
+        // Calculate high pulse width in ticks, unsigned subtraction handles timer wrap-around
+        tof_ticks = cap_value - dev->cap_val_begin;
+        if (tof_ticks > 0) {
+            // Notify the task to calculate the CO2 concentration
+            xTaskNotifyFromISR(dev->mcpwm_task_handle, tof_ticks, eSetValueWithOverwrite, &high_task_wakeup);
         }
-        break;
-        
-    default:
-        break;
+#if CONFIG_CJ202_STATS
+        pulse_end_us = esp_timer_get_time();
+#endif
     }
 
+#if CONFIG_CJ202_STATS
+    cj202_stats_edge(dev, start_cycles, pulse_end_us);
+#endif
     return high_task_wakeup == pdTRUE;
 }
 
+static bool co2_sensor_capture_callback(mcpwm_cap_channel_handle_t cap_chan, const mcpwm_capture_event_data_t *edata, void *user_data)
+{
+    return cj202_mcpwm_edge((cj202_dev_t *)user_data, edata->cap_edge == MCPWM_CAP_EDGE_POS, edata->cap_value);
+}
+
 static void cj202_mcpwm_task(void *arg)
 {
     cj202_dev_t *dev = (cj202_dev_t *)arg;
     uint32_t high_pulse_ticks;
-    float high_pulse_ms, period_ms;
-    const uint32_t apb_freq = esp_clk_apb_freq();
-    const float tick_to_us = 1000000.0f / apb_freq;
+    uint32_t high_pulse_us, period_us;
 
     ESP_LOGI(TAG, "CJ202 MCPWM capture task starting");
     
     while (1) {
-        // Wait for notification from ISR with high pulse width in ticks
-        if (xTaskNotifyWait(0x00, ULONG_MAX, &high_pulse_ticks, pdMS_TO_TICKS(CO2_CAPTURE_TIMEOUT_MS)) == pdTRUE) {
-            uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            uint32_t period_ticks = 0;
+        // Wait for notification from ISR with high pulse width in ticks.
+        // Missing cycles are detected by the health deadline, not by a timeout here.
+        if (xTaskNotifyWait(0x00, ULONG_MAX, &high_pulse_ticks, portMAX_DELAY) == pdTRUE) {
+            int64_t current_time = esp_timer_get_time();
             
-            // Calculate period if this is not the first measurement
+            // Calculate period if this is not the first measurement,
+            // otherwise fall back to the restored period (0 if none)
             if (!dev->first_measurement) {
-                // Calculate period in ms, convert to ticks
-                period_ticks = (current_time - dev->last_capture_time) * (apb_freq / 1000);
+                period_us = (uint32_t)(current_time - dev->last_capture_time);
             } else {
+                period_us = dev->learned_period_us;
                 dev->first_measurement = false;
             }
-            
             dev->last_capture_time = current_time;
             
-            // Convert ticks to microseconds and then to milliseconds
-            high_pulse_ms = (high_pulse_ticks * tick_to_us) / 1000.0f;
-            period_ms = (period_ticks * tick_to_us) / 1000.0f;
+            // Convert ticks to microseconds (fixed point, no division)
+            high_pulse_us = (uint32_t)((high_pulse_ticks * dev->ticks_to_us) >> CJ202_CONV_SHIFT);
             
             // Sanity check on measurements
-            if (period_ms > 0 && period_ms >= high_pulse_ms && 
-                period_ms >= CO2_PERIOD_MIN_MS && period_ms <= CO2_PERIOD_MAX_MS) {
+            if (period_us > 0 && period_us >= high_pulse_us && 
+                period_us >= CJ202_PERIOD_MIN_MS * 1000 && period_us <= CJ202_PERIOD_MAX_MS * 1000) {
                 
                 // Calculate CO2 ppm value
-                dev->co2_ppm = cj202_calculate_co2_ppm(high_pulse_ms, period_ms);
-                
-                // Save for next validation
-                dev->prev_high_ticks = high_pulse_ticks;
-                dev->prev_period_ticks = period_ticks;
-            } else if (dev->prev_period_ticks > 0) {
-                // Use previous valid values if current measurement is invalid
-                high_pulse_ms = (dev->prev_high_ticks * tick_to_us) / 1000.0f;
-                period_ms = (dev->prev_period_ticks * tick_to_us) / 1000.0f;
-                
-                dev->co2_ppm = cj202_calculate_co2_ppm(high_pulse_ms, period_ms);
-                
-                ESP_LOGW(TAG, "Using previous valid measurement: CO2: %"PRIu32"ppm", dev->co2_ppm);
+                cj202_publish_ppm(dev, cj202_calculate_co2_ppm(dev, high_pulse_us, period_us), high_pulse_us, period_us);
+            } else if (period_us > 0) {
+                // Keep the previous valid reading and let the health state flag the line
+                cj202_health_cycle_invalid(dev);
             }
-        } else {
-            ESP_LOGW(TAG, "Timeout waiting for PWM capture");
         }
     }
 }
@@ -138,22 +118,11 @@ static esp_err_t cleanup_resources(cj202_dev_t *dev, esp_err_t error)
     return error;
 }
 
-esp_err_t cj202_mcpwm_init(cj202_dev_t *dev)
+// Set up the capture timer and channel and start capturing
+static esp_err_t cj202_mcpwm_attach(cj202_dev_t *dev)
 {
     esp_err_t ret;
-    
-    if (dev == NULL) {
-        ESP_LOGE(TAG, "Device handle is NULL");
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    // Initialize device state
-    dev->co2_ppm = 0;
-    dev->prev_high_ticks = 0;
-    dev->prev_period_ticks = 0;
-    dev->first_measurement = true;
-    dev->last_capture_time = 0;
-    
+
     ESP_LOGI(TAG, "Installing capture timer");
     mcpwm_capture_timer_config_t cap_conf = {
         .clk_src = MCPWM_CAPTURE_CLK_SRC_DEFAULT,
@@ -217,12 +186,44 @@ esp_err_t cj202_mcpwm_init(cj202_dev_t *dev)
         return cleanup_resources(dev, ret);
     }
 
+    return ESP_OK;
+}
+
+esp_err_t cj202_mcpwm_init(cj202_dev_t *dev)
+{
+    esp_err_t ret;
+    
+    if (dev == NULL) {
+        ESP_LOGE(TAG, "Device handle is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    // Initialize device state
+    dev->first_measurement = true;
+    dev->last_capture_time = 0;
+    dev->pos_edge_captured = false;
+    dev->ticks_to_us = ((uint64_t)1000000 << CJ202_CONV_SHIFT) / esp_clk_apb_freq();
+    
+    ret = ESP_OK;
+#if CONFIG_CJ202_SIMULATOR
+    // Edges come from the simulator, leave the MCPWM peripheral alone
+    if (!dev->sim.enable)
+#endif
+    {
+        ret = cj202_mcpwm_attach(dev);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
     // Create task for processing MCPWM captures
     BaseType_t task_ret = xTaskCreate(cj202_mcpwm_task, "cj202_mcpwm_task", 
                                      CO2_TASK_STACK_SIZE, dev, 10, &dev->mcpwm_task_handle);
     if (task_ret != pdPASS) {
         ESP_LOGE(TAG, "Task creation failed");
-        mcpwm_capture_timer_stop(*(mcpwm_cap_timer_handle_t *)&dev->cap_timer);
+        if (dev->cap_timer != NULL) {
+            mcpwm_capture_timer_stop(*(mcpwm_cap_timer_handle_t *)&dev->cap_timer);
+        }
         return cleanup_resources(dev, ESP_FAIL);
     }
     
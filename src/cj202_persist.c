@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <sys/time.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "cj202_internal.h"
+
+static const char *TAG = "CJ202_PERSIST";
+
+#define PERSIST_NAMESPACE "cj202"
+
+static uint32_t snapshot_hash(const cj202_snapshot_t *snap)
+{
+    const uint8_t *p = (const uint8_t *)snap;
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < offsetof(cj202_snapshot_t, saved_at_s); i++) {
+        hash = (hash ^ p[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void snapshot_key(const cj202_dev_t *dev, char *key, size_t len)
+{
+    snprintf(key, len, "cj202_gpio%u", dev->gpio_num);
+}
+
+static int64_t system_time_s(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec;
+}
+
+static esp_err_t nvs_load(const char *key, void *buf, size_t *len, void *ctx)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(PERSIST_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret == ESP_OK) {
+        ret = nvs_get_blob(nvs, key, buf, len);
+        nvs_close(nvs);
+    }
+    return ret == ESP_ERR_NVS_NOT_FOUND ? ESP_ERR_NOT_FOUND : ret;
+}
+
+static esp_err_t nvs_store(const char *key, const void *buf, size_t len, void *ctx)
+{
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(PERSIST_NAMESPACE, NVS_READWRITE, &nvs);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = nvs_set_blob(nvs, key, buf, len);
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+static const cj202_persist_ops_t nvs_ops = {
+    .load = nvs_load,
+    .store = nvs_store,
+    .ctx = NULL,
+};
+
+static void cj202_persist_restore(cj202_dev_t *dev)
+{
+    cj202_snapshot_t snap;
+    size_t len = sizeof(snap);
+    char key[16];
+
+    snapshot_key(dev, key, sizeof(key));
+    esp_err_t ret = dev->persist_ops->load(key, &snap, &len, dev->persist_ops->ctx);
+    if (ret == ESP_ERR_NOT_FOUND) {
+        ESP_LOGI(TAG, "GPIO %d: no saved state", dev->gpio_num);
+        return;
+    }
+    if (ret != ESP_OK || len != sizeof(snap) || snap.version != CJ202_PERSIST_VERSION || snap.hash != snapshot_hash(&snap)) {
+        ESP_LOGW(TAG, "GPIO %d: discarding saved state (%s)", dev->gpio_num,
+                 ret != ESP_OK ? esp_err_to_name(ret) : "invalid snapshot");
+        return;
+    }
+    if (snap.mode != dev->mode || snap.range_ppm != dev->conv.range_ppm) {
+        ESP_LOGW(TAG, "GPIO %d: discarding saved state, configuration changed", dev->gpio_num);
+        return;
+    }
+
+    // Published as of now, health stays STALE until a new cycle arrives
+    dev->co2_ppm = snap.ppm;
+    dev->sample_time_us = esp_timer_get_time();
+    dev->learned_period_us = snap.learned_period_us;
+    dev->persist_hash = snap.hash;
+
+    // History only makes sense if the window matches and the gap is short
+    int64_t age_s = system_time_s() - snap.saved_at_s;
+    bool restore_trend = snap.trend.config.window == dev->trend.config.window &&
+                         age_s >= 0 && age_s <= CONFIG_CJ202_PERSIST_MAX_AGE_S;
+    if (restore_trend) {
+        cj202_trend_config_t config = dev->trend.config;
+        dev->trend = snap.trend;
+        dev->trend.config = config;
+    }
+
+    ESP_LOGI(TAG, "GPIO %d: restored CO2=%"PRIu32"ppm, period=%"PRIu32"us, %d trend samples",
+             dev->gpio_num, snap.ppm, snap.learned_period_us, restore_trend ? snap.trend.count : 0);
+}
+
+// Runs in the esp_timer task and holds it for the whole store() call, see
+// CONFIG_CJ202_PERSIST_INTERVAL_SAMPLES
+static void cj202_persist_deferred(void *arg)
+{
+    cj202_dev_t *dev = (cj202_dev_t *)arg;
+
+    portENTER_CRITICAL(&dev->lock);
+    if (dev->persist_stopping) {
+        portEXIT_CRITICAL(&dev->lock);
+        return;
+    }
+    dev->persist_running = true;
+    portEXIT_CRITICAL(&dev->lock);
+
+    cj202_persist_save(dev);
+
+    portENTER_CRITICAL(&dev->lock);
+    dev->persist_running = false;
+    portEXIT_CRITICAL(&dev->lock);
+}
+
+esp_err_t cj202_persist_init(cj202_dev_t *dev, const cj202_persist_config_t *config)
+{
+    dev->persist_ops = NULL;
+    dev->persist_pending = 0;
+    dev->persist_hash = 0;
+    dev->persist_timer = NULL;
+    dev->persist_stopping = false;
+    dev->persist_running = false;
+
+    if (!config->enable) {
+        return ESP_OK;
+    }
+
+    if (config->ops != NULL && (config->ops->load == NULL || config->ops->store == NULL)) {
+        ESP_LOGE(TAG, "Persistence ops must provide load and store");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = cj202_persist_deferred,
+        .arg = dev,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "cj202_persist",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &dev->persist_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create persistence timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    dev->persist_ops = config->ops != NULL ? config->ops : &nvs_ops;
+    cj202_persist_restore(dev);
+    return ESP_OK;
+}
+
+esp_err_t cj202_persist_deinit(cj202_dev_t *dev)
+{
+    esp_err_t ret = cj202_timer_teardown(dev, &dev->persist_timer, &dev->persist_stopping, &dev->persist_running);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "GPIO %d: failed to delete persistence timer: %s", dev->gpio_num, esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+esp_err_t cj202_persist_save(cj202_dev_t *dev)
+{
+    cj202_snapshot_t snap;
+    char key[16];
+
+    if (dev->persist_ops == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    memset(&snap, 0, sizeof(snap));
+    snap.version = CJ202_PERSIST_VERSION;
+    snap.mode = (uint8_t)dev->mode;
+    snap.range_ppm = (uint16_t)dev->conv.range_ppm;
+
+    portENTER_CRITICAL(&dev->lock);
+    snap.ppm = dev->co2_ppm;
+    snap.learned_period_us = dev->learned_period_us;
+    snap.trend = dev->trend;
+    portEXIT_CRITICAL(&dev->lock);
+
+    snap.hash = snapshot_hash(&snap);
+    dev->persist_pending = 0;
+    if (snap.hash == dev->persist_hash) {
+        // Unchanged since the last write, spare the flash
+        return ESP_OK;
+    }
+    snap.saved_at_s = system_time_s();
+
+    snapshot_key(dev, key, sizeof(key));
+    esp_err_t ret = dev->persist_ops->store(key, &snap, sizeof(snap), dev->persist_ops->ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "GPIO %d: failed to save state: %s", dev->gpio_num, esp_err_to_name(ret));
+        return ret;
+    }
+
+    dev->persist_hash = snap.hash;
+    ESP_LOGD(TAG, "GPIO %d: state saved", dev->gpio_num);
+    return ESP_OK;
+}
+
+void cj202_persist_sample(cj202_dev_t *dev, uint32_t high_us, uint32_t period_us)
+{
+    if (dev->persist_ops == NULL || ++dev->persist_pending < CONFIG_CJ202_PERSIST_INTERVAL_SAMPLES) {
+        return;
+    }
+
+    // Called right after the falling edge: write in the middle of the longer of
+    // the coming low and high levels, so the flash write does not delay an edge
+    uint32_t low_us = period_us - high_us;
+    uint64_t delay_us = low_us >= high_us ? low_us / 2 : low_us + high_us / 2;
+
+    // Fails harmlessly while a save is already scheduled
+    esp_timer_start_once(dev->persist_timer, delay_us);
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "cj202_internal.h"
+
+#if CONFIG_CJ202_SIMULATOR
+
+#include "esp_private/esp_clk.h"
+
+static const char *TAG = "CJ202_SIM";
+
+// Deliver edges from interrupt context like real captures when esp_timer allows it
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+#define SIM_DISPATCH_METHOD ESP_TIMER_ISR
+#define SIM_ATTR IRAM_ATTR
+#else
+#define SIM_DISPATCH_METHOD ESP_TIMER_TASK
+#define SIM_ATTR
+#endif
+
+static void SIM_ATTR cj202_sim_edge(void *arg)
+{
+    cj202_dev_t *dev = (cj202_dev_t *)arg;
+    cj202_sim_t *sim = &dev->sim;
+    int64_t now = esp_timer_get_time();
+    bool need_yield = false;
+
+    // Runs in ISR or esp_timer task context depending on the dispatch method
+    portENTER_CRITICAL_SAFE(&dev->lock);
+    if (sim->stopping) {
+        portEXIT_CRITICAL_SAFE(&dev->lock);
+        return;
+    }
+    sim->running = true;
+    portEXIT_CRITICAL_SAFE(&dev->lock);
+
+    sim->level = !sim->level;
+
+    // Schedule the next edge before handling this one, so handler time does not stretch the period
+    esp_timer_start_once(sim->timer, sim->level ? sim->high_us : sim->low_us);
+
+    switch (dev->mode) {
+    case CJ202_MODE_GPIO_INTERRUPT:
+        need_yield = cj202_gpio_edge(dev, sim->level, now);
+        break;
+#if !defined(CONFIG_IDF_TARGET_ESP32C2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+    case CJ202_MODE_MCPWM_CAPTURE:
+        need_yield = cj202_mcpwm_edge(dev, sim->level, (uint32_t)(now * sim->ticks_per_us));
+        break;
+#endif
+    default:
+        break;
+    }
+
+#if CONFIG_ESP_TIMER_SUPPORTS_ISR_DISPATCH_METHOD
+    if (need_yield) {
+        esp_timer_isr_dispatch_need_yield();
+    }
+#else
+    (void)need_yield;
+#endif
+
+    portENTER_CRITICAL_SAFE(&dev->lock);
+    sim->running = false;
+    portEXIT_CRITICAL_SAFE(&dev->lock);
+}
+
+esp_err_t cj202_sim_init(cj202_dev_t *dev, const cj202_sim_config_t *config)
+{
+    cj202_sim_t *sim = &dev->sim;
+    const cj202_conv_t *conv = &dev->conv;
+
+    sim->enable = false;
+    if (!config->enable) {
+        return ESP_OK;
+    }
+
+    uint32_t period_us = config->period_us ? config->period_us : CJ202_PERIOD_NOMINAL_MS * 1000;
+    uint32_t ppm = config->ppm > conv->range_ppm ? conv->range_ppm : config->ppm;
+
+    // Invert the linear conversion: TH = high_offset + ppm × (period - period_offset) / range
+    if (period_us <= conv->period_offset_us) {
+        ESP_LOGE(TAG, "Simulated period too short: %"PRIu32"us", period_us);
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim->high_us = conv->high_offset_us + (uint32_t)((uint64_t)ppm * (period_us - conv->period_offset_us) / conv->range_ppm);
+    if (sim->high_us >= period_us) {
+        ESP_LOGE(TAG, "Simulated high time %"PRIu32"us does not fit the period", sim->high_us);
+        return ESP_ERR_INVALID_ARG;
+    }
+    sim->low_us = period_us - sim->high_us;
+    sim->ticks_per_us = esp_clk_apb_freq() / 1000000;
+    sim->level = 0;
+    sim->stopping = false;
+    sim->running = false;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = cj202_sim_edge,
+        .arg = dev,
+        .dispatch_method = SIM_DISPATCH_METHOD,
+        .name = "cj202_sim",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &sim->timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create simulator timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    sim->enable = true;
+    ESP_LOGI(TAG, "GPIO %d simulated: %"PRIu32"ppm, high=%"PRIu32"us, low=%"PRIu32"us",
+             dev->gpio_num, ppm, sim->high_us, sim->low_us);
+    return ESP_OK;
+}
+
+esp_err_t cj202_sim_start(cj202_dev_t *dev)
+{
+    if (!dev->sim.enable) {
+        return ESP_OK;
+    }
+
+    // Line starts low, the first edge is a rising one
+    return esp_timer_start_once(dev->sim.timer, dev->sim.low_us);
+}
+
+esp_err_t cj202_sim_deinit(cj202_dev_t *dev)
+{
+    cj202_sim_t *sim = &dev->sim;
+
+    esp_err_t ret = cj202_timer_teardown(dev, &sim->timer, &sim->stopping, &sim->running);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to delete simulator timer: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+#endif /* CONFIG_CJ202_SIMULATOR */
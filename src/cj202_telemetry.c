@@ -0,0 +1,184 @@
+#include <stdbool.h>
+#include <string.h>
+#include "cj202_telemetry.h"
+
+#define FRAME_HEADER_MAX_SIZE (2 + 10)
+#define QUALITY_BITS 3
+#define QUALITY_MASK ((1u << QUALITY_BITS) - 1)
+
+static size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t get_varint(const uint8_t *p, size_t len, uint64_t *v)
+{
+    uint64_t result = 0;
+
+    for (size_t n = 0; n < len && n < 10; n++) {
+        result |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if ((p[n] & 0x80) == 0) {
+            *v = result;
+            return n + 1;
+        }
+    }
+    return 0; // Truncated or overlong
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+// *sum = a + b, false instead of a signed overflow
+static bool add_int64(int64_t a, int64_t b, int64_t *sum)
+{
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+        return false;
+    }
+    *sum = a + b;
+    return true;
+}
+
+esp_err_t cj202_telemetry_encoder_init(cj202_telemetry_encoder_t *enc, uint8_t *buf, size_t size, int64_t base_ms)
+{
+    if (enc == NULL || buf == NULL || base_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t header[FRAME_HEADER_MAX_SIZE];
+    size_t len = 0;
+    header[len++] = CJ202_TELEMETRY_MAGIC;
+    header[len++] = CJ202_TELEMETRY_VERSION;
+    len += put_varint(&header[len], (uint64_t)base_ms);
+    if (len > size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memset(enc, 0, sizeof(*enc));
+    memcpy(buf, header, len);
+    enc->buf = buf;
+    enc->size = size;
+    enc->len = len;
+    enc->base_ms = base_ms;
+    for (int i = 0; i < CJ202_TELEMETRY_MAX_CHANNELS; i++) {
+        enc->chan[i].last_ms = base_ms;
+    }
+    return ESP_OK;
+}
+
+esp_err_t cj202_telemetry_encode(cj202_telemetry_encoder_t *enc, const cj202_telemetry_record_t *record)
+{
+    if (enc == NULL || record == NULL || record->channel >= CJ202_TELEMETRY_MAX_CHANNELS ||
+        record->quality > QUALITY_MASK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cj202_telemetry_channel_t *chan = &enc->chan[record->channel];
+    int64_t interval_ms = record->timestamp_ms - chan->last_ms;
+    if (interval_ms < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Encode into scratch first so a full frame is left untouched
+    uint8_t rec[CJ202_TELEMETRY_RECORD_MAX_SIZE];
+    size_t len = 0;
+    len += put_varint(&rec[len], ((uint64_t)record->channel << QUALITY_BITS) | record->quality);
+    len += put_varint(&rec[len], zigzag(interval_ms - chan->last_interval_ms));
+    len += put_varint(&rec[len], zigzag((int64_t)record->ppm - (int64_t)chan->last_ppm));
+    if (enc->len + len > enc->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(&enc->buf[enc->len], rec, len);
+    enc->len += len;
+    enc->count++;
+    chan->last_ms = record->timestamp_ms;
+    chan->last_interval_ms = interval_ms;
+    chan->last_ppm = record->ppm;
+    return ESP_OK;
+}
+
+esp_err_t cj202_telemetry_decode(const uint8_t *frame, size_t len, cj202_telemetry_record_cb_t cb, void *user_ctx)
+{
+    // Same as cj202_telemetry_channel_t, with a signed ppm to catch bad deltas
+    struct decode_channel {
+        int64_t last_ms;
+        int64_t last_interval_ms;
+        int64_t last_ppm;
+    } chan[CJ202_TELEMETRY_MAX_CHANNELS];
+    uint64_t v;
+    size_t pos = 2, n;
+
+    if (frame == NULL || cb == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len < 3 || frame[0] != CJ202_TELEMETRY_MAGIC || frame[1] != CJ202_TELEMETRY_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    n = get_varint(&frame[pos], len - pos, &v);
+    if (n == 0 || v > INT64_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    pos += n;
+    for (int i = 0; i < CJ202_TELEMETRY_MAX_CHANNELS; i++) {
+        chan[i].last_ms = (int64_t)v;
+        chan[i].last_interval_ms = 0;
+        chan[i].last_ppm = 0;
+    }
+
+    while (pos < len) {
+        cj202_telemetry_record_t record;
+        uint64_t tag, interval, ppm;
+
+        n = get_varint(&frame[pos], len - pos, &tag);
+        if (n == 0 || (tag >> QUALITY_BITS) >= CJ202_TELEMETRY_MAX_CHANNELS) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pos += n;
+        n = get_varint(&frame[pos], len - pos, &interval);
+        if (n == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pos += n;
+        n = get_varint(&frame[pos], len - pos, &ppm);
+        if (n == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        pos += n;
+
+        record.channel = (uint8_t)(tag >> QUALITY_BITS);
+        record.quality = (uint8_t)(tag & QUALITY_MASK);
+
+        // Frames come from the air, reject anything that would overflow
+        struct decode_channel *c = &chan[record.channel];
+        int64_t interval_ms, time_ms, ppm_value;
+        if (!add_int64(c->last_interval_ms, unzigzag(interval), &interval_ms) || interval_ms < 0 ||
+            !add_int64(c->last_ms, interval_ms, &time_ms) ||
+            !add_int64(c->last_ppm, unzigzag(ppm), &ppm_value) || ppm_value < 0 || ppm_value > UINT32_MAX) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        c->last_interval_ms = interval_ms;
+        c->last_ms = time_ms;
+        c->last_ppm = ppm_value;
+
+        record.timestamp_ms = c->last_ms;
+        record.ppm = (uint32_t)c->last_ppm;
+        cb(&record, user_ctx);
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "cj202_internal.h"
+
+static const char *TAG = "CJ202_TREND";
+
+esp_err_t cj202_trend_init(cj202_dev_t *dev, const cj202_trend_config_t *config)
+{
+    if (config->window == 1 || config->window > CONFIG_CJ202_TREND_WINDOW_MAX) {
+        ESP_LOGE(TAG, "Invalid trend window: %d (2-%d, or 0 to disable)",
+                 config->window, CONFIG_CJ202_TREND_WINDOW_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&dev->trend, 0, sizeof(dev->trend));
+    dev->trend.config = *config;
+    dev->trend.state = CJ202_TREND_STEADY;
+    return ESP_OK;
+}
+
+static void cj202_trend_emit(cj202_dev_t *dev, cj202_event_type_t type, uint32_t ppm)
+{
+    ESP_LOGD(TAG, "Trend event %d: CO2=%"PRIu32"ppm, slope=%"PRId32"ppm/min",
+             type, ppm, dev->trend.slope_ppm_per_min);
+
+    cj202_event_t event = {
+        .type = type,
+    };
+    cj202_emit_event(dev, &event);
+}
+
+static void cj202_trend_detect(cj202_dev_t *dev, uint32_t ppm)
+{
+    cj202_trend_t *trend = &dev->trend;
+    const int32_t slope = trend->slope_ppm_per_min;
+    const int32_t rise = trend->config.rise_ppm_per_min;
+    const int32_t fall = -(int32_t)trend->config.fall_ppm_per_min;
+    const int32_t hyst = trend->config.hysteresis_ppm_per_min;
+
+    switch (trend->state) {
+    case CJ202_TREND_STEADY:
+        if (rise > 0 && slope >= rise) {
+            trend->state = CJ202_TREND_RISING;
+            cj202_trend_emit(dev, CJ202_EVENT_OCCUPANCY_ONSET, ppm);
+        } else if (fall < 0 && slope <= fall) {
+            trend->state = CJ202_TREND_FALLING;
+            cj202_trend_emit(dev, CJ202_EVENT_VENTILATION, ppm);
+        }
+        break;
+
+    case CJ202_TREND_RISING:
+        if (slope < rise - hyst) {
+            trend->state = CJ202_TREND_STEADY;
+            cj202_trend_emit(dev, CJ202_EVENT_TREND_STEADY, ppm);
+        }
+        break;
+
+    case CJ202_TREND_FALLING:
+        if (slope > fall + hyst) {
+            trend->state = CJ202_TREND_STEADY;
+            cj202_trend_emit(dev, CJ202_EVENT_TREND_STEADY, ppm);
+        }
+        break;
+    }
+}
+
+void cj202_trend_update(cj202_dev_t *dev, uint32_t ppm, uint32_t period_us)
+{
+    cj202_trend_t *trend = &dev->trend;
+    const uint8_t window = trend->config.window;
+    const int64_t y = ppm > UINT16_MAX ? UINT16_MAX : ppm;
+
+    if (window == 0 || period_us == 0) {
+        return;
+    }
+
+    // Locked against snapshots taken by the persistence layer
+    portENTER_CRITICAL(&dev->lock);
+    if (trend->count < window) {
+        // Window still filling: the new sample gets the next index
+        trend->ring[(trend->head + trend->count) % window] = (uint16_t)y;
+        trend->sum_xy += (int64_t)trend->count * y;
+        trend->sum_y += y;
+        trend->count++;
+    } else {
+        // Window full: drop the oldest sample and shift every index down by one
+        const int64_t oldest = trend->ring[trend->head];
+        trend->ring[trend->head] = (uint16_t)y;
+        trend->head = (trend->head + 1) % window;
+        trend->sum_xy += -(trend->sum_y - oldest) + (int64_t)(window - 1) * y;
+        trend->sum_y += y - oldest;
+    }
+    const int64_t n = trend->count;
+    const int64_t sum_y = trend->sum_y;
+    const int64_t sum_xy = trend->sum_xy;
+    portEXIT_CRITICAL(&dev->lock);
+
+    if (n < 2) {
+        return;
+    }
+
+    // Least squares slope with x = 0..n-1:
+    //   Sx = n(n-1)/2, n*Sxx - Sx^2 = n^2(n^2-1)/12
+    const int64_t sum_x = n * (n - 1) / 2;
+    const int64_t num = n * sum_xy - sum_x * sum_y;
+    const int64_t den = n * n * (n * n - 1) / 12;
+
+    // ppm per sample -> ppm per minute
+    trend->slope_ppm_per_min = (int32_t)(num * 60000000 / (den * (int64_t)period_us));
+
+    cj202_trend_detect(dev, ppm);
+}